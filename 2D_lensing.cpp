@@ -5,6 +5,9 @@
 #include <glm/gtc/type_ptr.hpp>
 #include <vector>
 #include <iostream>
+#include <memory>
+#include "cli_args.h"
+#include "trajectory_recorder.h"
 #define _USE_MATH_DEFINES
 #include <cmath>
 #ifndef M_PI
@@ -16,8 +19,14 @@ using namespace std;
 double c = 299792458.0;
 double G = 6.67430e-11;
 
-struct Ray;
-void rk4Step(Ray& ray, double dλ, double rs);
+// Integration state of one ray: only what the geodesic equations evolve.
+// Plain data, so the RK4 stages live on the stack and a step never allocates
+// or touches the trail.
+struct RayState {
+    double r;   double phi;
+    double dr;  double dphi;
+};
+void rk4Step(RayState& s, double E, double dλ, double rs);
 
 // --- Structs --- //
 struct Engine {
@@ -93,23 +102,22 @@ BlackHole SagA(vec3(0.0f, 0.0f, 0.0f), 8.54e36); // Sagittarius A black hole
 struct Ray{
     // -- cartesian coords -- //
     double x;   double y;
-    // -- polar coords -- //
-    double r;   double phi;
-    double dr;  double dphi;
+    // -- polar coords, integrated by rk4Step -- //
+    RayState s;
     vector<vec2> trail; // trail of points
     double E, L;             // conserved quantities
 
-    Ray(vec2 pos, vec2 dir) : x(pos.x), y(pos.y), r(sqrt(pos.x * pos.x + pos.y * pos.y)), phi(atan2(pos.y, pos.x)), dr(dir.x), dphi(dir.y) {
+    Ray(vec2 pos, vec2 dir) : x(pos.x), y(pos.y) {
         // step 1) get polar coords (r, phi) :
-        this->r = sqrt(x*x + y*y);
-        this->phi = atan2(y, x);
+        s.r = sqrt(x*x + y*y);
+        s.phi = atan2(y, x);
         // step 2) seed velocities :
-        dr = dir.x * cos(phi) + dir.y * sin(phi); // m/s
-        dphi  = ( -dir.x * sin(phi) + dir.y * cos(phi) ) / r;
+        s.dr = dir.x * cos(s.phi) + dir.y * sin(s.phi); // m/s
+        s.dphi  = ( -dir.x * sin(s.phi) + dir.y * cos(s.phi) ) / s.r;
         // step 3) store conserved quantities
-        L = r*r * dphi;
-        double f = 1.0 - SagA.r_s/r;  
-        double dt_dλ = sqrt( (dr*dr)/(f*f) + (r*r*dphi*dphi)/f );
+        L = s.r*s.r * s.dphi;
+        double f = 1.0 - SagA.r_s/s.r;  
+        double dt_dλ = sqrt( (s.dr*s.dr)/(f*f) + (s.r*s.r*s.dphi*s.dphi)/f );
         E = f * dt_dλ;
         // step 4) start trail :
         trail.push_back({x, y});
@@ -148,12 +156,12 @@ struct Ray{
     }
     void step(double dλ, double rs) {
         // 1) integrate (r,φ,dr,dφ)
-        if(r <= rs) return; // stop if inside the event horizon
-        rk4Step(*this, dλ, rs);
+        if(s.r <= rs) return; // stop if inside the event horizon
+        rk4Step(s, E, dλ, rs);
 
         // 2) convert back to cartesian x,y
-        x = r * cos(phi);
-        y = r * sin(phi);
+        x = s.r * cos(s.phi);
+        y = s.r * sin(s.phi);
 
         // 3) record the trail
         trail.push_back({ float(x), float(y) });
@@ -161,66 +169,77 @@ struct Ray{
 };
 vector<Ray> rays;
 
-void geodesicRHS(const Ray& ray, double rhs[4], double rs) {
-    double r    = ray.r;
-    double dr   = ray.dr;
-    double dphi = ray.dphi;
-    double E    = ray.E;
+// Derivative of the state along λ; E is the ray's conserved energy.
+RayState geodesicRHS(const RayState& s, double E, double rs) {
+    double r    = s.r;
+    double dr   = s.dr;
+    double dphi = s.dphi;
 
     double f = 1.0 - rs/r;
+    RayState rhs;
 
     // dr/dλ = dr
-    rhs[0] = dr;
+    rhs.r = dr;
     // dφ/dλ = dphi
-    rhs[1] = dphi;
+    rhs.phi = dphi;
 
     // d²r/dλ² from Schwarzschild null geodesic:
     double dt_dλ = E / f;
-    rhs[2] = 
+    rhs.dr = 
         - (rs/(2*r*r)) * f * (dt_dλ*dt_dλ)
         + (rs/(2*r*r*f)) * (dr*dr)
         + (r - rs) * (dphi*dphi);
 
     // d²φ/dλ² = -2*(dr * dphi) / r
-    rhs[3] = -2.0 * dr * dphi / r;
+    rhs.dphi = -2.0 * dr * dphi / r;
+    return rhs;
 }
-void addState(const double a[4], const double b[4], double factor, double out[4]) {
-    for (int i = 0; i < 4; i++)
-        out[i] = a[i] + b[i] * factor;
+RayState addState(const RayState& a, const RayState& b, double factor) {
+    return { a.r + b.r * factor, a.phi + b.phi * factor,
+             a.dr + b.dr * factor, a.dphi + b.dphi * factor };
 }
-void rk4Step(Ray& ray, double dλ, double rs) {
-    double y0[4] = { ray.r, ray.phi, ray.dr, ray.dphi };
-    double k1[4], k2[4], k3[4], k4[4], temp[4];
-
-    geodesicRHS(ray, k1, rs);
-    addState(y0, k1, dλ/2.0, temp);
-    Ray r2 = ray; r2.r=temp[0]; r2.phi=temp[1]; r2.dr=temp[2]; r2.dphi=temp[3];
-    geodesicRHS(r2, k2, rs);
-
-    addState(y0, k2, dλ/2.0, temp);
-    Ray r3 = ray; r3.r=temp[0]; r3.phi=temp[1]; r3.dr=temp[2]; r3.dphi=temp[3];
-    geodesicRHS(r3, k3, rs);
-
-    addState(y0, k3, dλ, temp);
-    Ray r4 = ray; r4.r=temp[0]; r4.phi=temp[1]; r4.dr=temp[2]; r4.dphi=temp[3];
-    geodesicRHS(r4, k4, rs);
-
-    ray.r    += (dλ/6.0)*(k1[0] + 2*k2[0] + 2*k3[0] + k4[0]);
-    ray.phi  += (dλ/6.0)*(k1[1] + 2*k2[1] + 2*k3[1] + k4[1]);
-    ray.dr   += (dλ/6.0)*(k1[2] + 2*k2[2] + 2*k3[2] + k4[2]);
-    ray.dphi += (dλ/6.0)*(k1[3] + 2*k2[3] + 2*k3[3] + k4[3]);
+void rk4Step(RayState& s, double E, double dλ, double rs) {
+    RayState k1 = geodesicRHS(s, E, rs);
+    RayState k2 = geodesicRHS(addState(s, k1, dλ/2.0), E, rs);
+    RayState k3 = geodesicRHS(addState(s, k2, dλ/2.0), E, rs);
+    RayState k4 = geodesicRHS(addState(s, k3, dλ), E, rs);
+
+    s.r    += (dλ/6.0)*(k1.r    + 2*k2.r    + 2*k3.r    + k4.r);
+    s.phi  += (dλ/6.0)*(k1.phi  + 2*k2.phi  + 2*k3.phi  + k4.phi);
+    s.dr   += (dλ/6.0)*(k1.dr   + 2*k2.dr   + 2*k3.dr   + k4.dr);
+    s.dphi += (dλ/6.0)*(k1.dphi + 2*k2.dphi + 2*k3.dphi + k4.dphi);
 }
 
 
-int main () {
+int main (int argc, char** argv) {
+    CliArgs args(argc, argv);
     //rays.push_back(Ray(vec2(-1e11, 3.27606302719999999e10), vec2(c, 0.0f)));
+
+    // --record file.trj: keep every ray's full path (trajectory_recorder.h), ids = ray index
+    unique_ptr<TrajectoryRecorder> recorder;
+    vector<TrajectoryRecorder::Trace> traces;
+    if (args.has("record")) {
+        recorder.reset(new TrajectoryRecorder(args.str("record", "trails.trj"), 2,
+                                              1e-4 * SagA.r_s, args.num("record-tolerance", 1e-3)));
+        if (!recorder->ok()) cerr << "[WARN] Cannot write " << args.str("record", "trails.trj") << endl;
+        for (size_t i = 0; i < rays.size(); ++i) {
+            traces.push_back(recorder->begin(i));
+            traces.back().add(rays[i].x, rays[i].y);
+        }
+    }
+
     while(!glfwWindowShouldClose(engine.window)) {
         engine.run();
         SagA.draw();
 
-        for (auto& ray : rays) {
+        for (size_t i = 0; i < rays.size(); ++i) {
+            Ray& ray = rays[i];
             ray.step(1.0f, SagA.r_s);
             ray.draw(rays);
+            if (i < traces.size()) {
+                if (ray.s.r > SagA.r_s) traces[i].add(ray.x, ray.y);
+                else traces[i].finish();
+            }
         }
 
         glfwSwapBuffers(engine.window);
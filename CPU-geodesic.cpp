@@ -101,8 +101,13 @@ struct Camera {
 };
 Camera camera;
 
-struct Ray;
-void rk4Step(Ray& ray, double dλ, double rs);
+// Integration state of one ray: only what the geodesic equations evolve.
+// Plain data, so the RK4 stages are built on the stack without copying a Ray.
+struct RayState {
+    double r;   double theta;  double phi;
+    double dr;  double dtheta; double dphi;
+};
+void rk4Step(RayState& s, double E, double dλ, double rs);
 
 struct Engine {
     // -- Quad & Texture render -- //
@@ -267,12 +272,13 @@ BlackHole SagA(vec3(0.0f, 0.0f, 0.0f), 8.54e36); // Sagittarius A black hole
 struct Ray{
     // -- cartesian coords -- //
     double x;   double y; double z;
-    // -- polar coords -- //
-    double r;   double phi; double theta;
-    double dr;  double dphi; double dtheta;
+    // -- spherical coords, integrated by rk4Step -- //
+    RayState s;
     double E, L;             // conserved quantities
 
     Ray(vec3 pos, vec3 dir) : x(pos.x), y(pos.y), z(pos.z) {
+        double &r = s.r, &theta = s.theta, &phi = s.phi;
+        double &dr = s.dr, &dtheta = s.dtheta, &dphi = s.dphi;
         // Step 1: get spherical coords (r, theta, phi)
         r = sqrt(x*x + y*y + z*z);
         theta = acos(z / r);
@@ -294,12 +300,12 @@ struct Ray{
         E = f * dt_dλ;
     }
     void step(double dλ, double rs) {
-        if (r <= rs) return;
-        rk4Step(*this, dλ, rs);
+        if (s.r <= rs) return;
+        rk4Step(s, E, dλ, rs);
         // convert back to cartesian
-        this->x = r * sin(theta) * cos(phi);
-        this->y = r * sin(theta) * sin(phi);
-        this->z = r * cos(theta);
+        this->x = s.r * sin(s.theta) * cos(s.phi);
+        this->y = s.r * sin(s.theta) * sin(s.phi);
+        this->z = s.r * cos(s.theta);
     }
 };
 
@@ -321,9 +327,6 @@ void raytrace(vector<unsigned char>& pixels, int W, int H) {
             float v = (1.0f - 2.0f * (y + 0.5f) / float(H))        * tanHalfFov;
             vec3 dir = normalize(u*right + v*up + forward);
 
-            // construct your Ray
-            Ray ray(camera.pos,  dir);
-
             const int MAX_STEPS = 10000;
             const double D_LAMBDA = 1e7;
             const double ESCAPE_R = 1e14;
@@ -350,7 +353,7 @@ void raytrace(vector<unsigned char>& pixels, int W, int H) {
                         break;
                     }
                     ray.step(D_LAMBDA, SagA.r_s);
-                    if (ray.r > ESCAPE_R) {
+                    if (ray.s.r > ESCAPE_R) {
                         // escaped to infinity → remains black
                         break;
                     }
@@ -365,69 +368,54 @@ void raytrace(vector<unsigned char>& pixels, int W, int H) {
     }
 }
 
-void geodesicRHS(const Ray& ray, double rhs[6], double rs) {
-    double r = ray.r;
-    double theta = ray.theta;
-    double dr = ray.dr;
-    double dtheta = ray.dtheta;
-    double dphi = ray.dphi;
-    double E = ray.E;
+// Derivative of the state along λ; E is the ray's conserved energy.
+RayState geodesicRHS(const RayState& s, double E, double rs) {
+    double r = s.r;
+    double theta = s.theta;
+    double dr = s.dr;
+    double dtheta = s.dtheta;
+    double dphi = s.dphi;
 
     double f = 1.0 - rs / r;
     double dt_dlambda = E / f;
+    RayState rhs;
 
     // First derivatives
-    rhs[0] = dr;
-    rhs[1] = dtheta;
-    rhs[2] = dphi;
+    rhs.r = dr;
+    rhs.theta = dtheta;
+    rhs.phi = dphi;
 
     // Second derivatives (from 3D Schwarzschild null geodesics):
-    rhs[3] = 
+    rhs.dr = 
         - (rs / (2 * r * r)) * f * dt_dlambda * dt_dlambda
         + (rs / (2 * r * r * f)) * dr * dr
         + r * (dtheta * dtheta + sin(theta) * sin(theta) * dphi * dphi);
 
-    rhs[4] = 
+    rhs.dtheta = 
         - (2.0 / r) * dr * dtheta
         + sin(theta) * cos(theta) * dphi * dphi;
 
-    rhs[5] = 
+    rhs.dphi = 
         - (2.0 / r) * dr * dphi
         - 2.0 * cos(theta) / sin(theta) * dtheta * dphi;
+    return rhs;
 }
-void addState(const double a[6], const double b[6], double factor, double out[6]) {
-    for (int i = 0; i < 6; i++)
-        out[i] = a[i] + b[i] * factor;
+RayState addState(const RayState& a, const RayState& b, double factor) {
+    return { a.r + b.r * factor, a.theta + b.theta * factor, a.phi + b.phi * factor,
+             a.dr + b.dr * factor, a.dtheta + b.dtheta * factor, a.dphi + b.dphi * factor };
 }
-void rk4Step(Ray& ray, double dλ, double rs) {
-    double y0[6] = { ray.r, ray.theta, ray.phi, ray.dr, ray.dtheta, ray.dphi };
-    double k1[6], k2[6], k3[6], k4[6], temp[6];
-
-    geodesicRHS(ray, k1, rs);
-    addState(y0, k1, dλ/2.0, temp);
-    Ray r2 = ray;
-    r2.r = temp[0]; r2.theta = temp[1]; r2.phi = temp[2];
-    r2.dr = temp[3]; r2.dtheta = temp[4]; r2.dphi = temp[5];
-    geodesicRHS(r2, k2, rs);
-
-    addState(y0, k2, dλ/2.0, temp);
-    Ray r3 = ray;
-    r3.r = temp[0]; r3.theta = temp[1]; r3.phi = temp[2];
-    r3.dr = temp[3]; r3.dtheta = temp[4]; r3.dphi = temp[5];
-    geodesicRHS(r3, k3, rs);
-
-    addState(y0, k3, dλ, temp);
-    Ray r4 = ray;
-    r4.r = temp[0]; r4.theta = temp[1]; r4.phi = temp[2];
-    r4.dr = temp[3]; r4.dtheta = temp[4]; r4.dphi = temp[5];
-    geodesicRHS(r4, k4, rs);
-
-    ray.r      += (dλ/6.0)*(k1[0] + 2*k2[0] + 2*k3[0] + k4[0]);
-    ray.theta  += (dλ/6.0)*(k1[1] + 2*k2[1] + 2*k3[1] + k4[1]);
-    ray.phi    += (dλ/6.0)*(k1[2] + 2*k2[2] + 2*k3[2] + k4[2]);
-    ray.dr     += (dλ/6.0)*(k1[3] + 2*k2[3] + 2*k3[3] + k4[3]);
-    ray.dtheta += (dλ/6.0)*(k1[4] + 2*k2[4] + 2*k3[4] + k4[4]);
-    ray.dphi   += (dλ/6.0)*(k1[5] + 2*k2[5] + 2*k3[5] + k4[5]);
+void rk4Step(RayState& s, double E, double dλ, double rs) {
+    RayState k1 = geodesicRHS(s, E, rs);
+    RayState k2 = geodesicRHS(addState(s, k1, dλ/2.0), E, rs);
+    RayState k3 = geodesicRHS(addState(s, k2, dλ/2.0), E, rs);
+    RayState k4 = geodesicRHS(addState(s, k3, dλ), E, rs);
+
+    s.r      += (dλ/6.0)*(k1.r      + 2*k2.r      + 2*k3.r      + k4.r);
+    s.theta  += (dλ/6.0)*(k1.theta  + 2*k2.theta  + 2*k3.theta  + k4.theta);
+    s.phi    += (dλ/6.0)*(k1.phi    + 2*k2.phi    + 2*k3.phi    + k4.phi);
+    s.dr     += (dλ/6.0)*(k1.dr     + 2*k2.dr     + 2*k3.dr     + k4.dr);
+    s.dtheta += (dλ/6.0)*(k1.dtheta + 2*k2.dtheta + 2*k3.dtheta + k4.dtheta);
+    s.dphi   += (dλ/6.0)*(k1.dphi   + 2*k2.dphi   + 2*k3.dphi   + k4.dphi);
 }
 
 void setupCameraCallbacks(GLFWwindow* window) {
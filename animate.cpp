@@ -0,0 +1,253 @@
+// Keyframed flythrough renderer with checkpoint/resume.
+//
+// Keyframes come from a text file, one per line ('#' starts a comment):
+//
+//   # frame  distance  azimuth  elevation  fov  exposure  t_max
+//   0        20        0        85         40   1.5       1.5e4
+//   120      8         180      70         55   2.0       2.0e4
+//
+// distance in Schwarzschild radii, angles in degrees (the Camera model of
+// black_hole.cpp: elevation from +y). Every column is interpolated with a
+// Catmull-Rom spline over the key frame numbers.
+//
+//   BlackHoleAnimate --keys flight.keys --out-dir frames --width 640 --height 360
+//
+// Frames are handed out to the thread pool in contiguous runs. Consecutive
+// frames reuse the deflection table of their camera radius and, when only
+// exposure or temperature change, the whole G-buffer. Each frame is rendered
+// in row tiles; finished tiles go to frame_NNNNN.partial and finished frames
+// to frame_NNNNN.ppm, both written atomically, so rerunning the same command
+// after a crash resumes at the first unfinished tile.
+#include "geodesic_core.h"
+#include "observer.h"
+#include "gbuffer.h"
+#include "deflection_table.h"
+#include "emission_tables.h"
+#include "disk_shading.h"
+#include "checkpoint.h"
+#include "parallel.h"
+#include "cli_args.h"
+#include <atomic>
+#include <chrono>
+#include <fstream>
+#include <iostream>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <vector>
+using namespace std;
+using Clock = std::chrono::high_resolution_clock;
+
+// One keyframe / interpolated frame; the fields are spline channels.
+struct FrameParams {
+    double distance = 20.0, azimuth = 0.0, elevation = 85.0, fov = 40.0;
+    double exposure = 1.5, tMax = 1.5e4;
+
+    static constexpr int CHANNELS = 6;
+    double& operator[](int i) { return (&distance)[i]; }
+    double operator[](int i) const { return (&distance)[i]; }
+
+    bool sameGeometry(const FrameParams& o) const {
+        return distance == o.distance && azimuth == o.azimuth
+            && elevation == o.elevation && fov == o.fov;
+    }
+};
+
+struct Keyframe {
+    double frame;
+    FrameParams p;
+};
+
+vector<Keyframe> loadKeyframes(const string& path) {
+    vector<Keyframe> keys;
+    ifstream in(path);
+    string line;
+    while (getline(in, line)) {
+        line = line.substr(0, line.find('#'));
+        stringstream ss(line);
+        Keyframe k;
+        if (!(ss >> k.frame)) continue;
+        for (int c = 0; c < FrameParams::CHANNELS; ++c)
+            if (!(ss >> k.p[c])) { cerr << "[WARN] Short keyframe line: " << line << "\n"; break; }
+        keys.push_back(k);
+    }
+    sort(keys.begin(), keys.end(), [](const Keyframe& a, const Keyframe& b) { return a.frame < b.frame; });
+    return keys;
+}
+
+// Cubic Hermite with Catmull-Rom tangents over non-uniform key spacing.
+FrameParams interpolate(const vector<Keyframe>& keys, double frame) {
+    if (frame <= keys.front().frame) return keys.front().p;
+    if (frame >= keys.back().frame) return keys.back().p;
+    size_t i = 0;
+    while (keys[i + 1].frame < frame) ++i;
+    const Keyframe& k1 = keys[i];
+    const Keyframe& k2 = keys[i + 1];
+    const Keyframe& k0 = i > 0 ? keys[i - 1] : k1;
+    const Keyframe& k3 = i + 2 < keys.size() ? keys[i + 2] : k2;
+    double h = k2.frame - k1.frame;
+    double s = (frame - k1.frame) / h;
+    double s2 = s * s, s3 = s2 * s;
+    FrameParams out;
+    for (int c = 0; c < FrameParams::CHANNELS; ++c) {
+        double m1 = (k2.p[c] - k0.p[c]) / std::max(k2.frame - k0.frame, 1e-9) * h;
+        double m2 = (k3.p[c] - k1.p[c]) / std::max(k3.frame - k1.frame, 1e-9) * h;
+        out[c] = (2*s3 - 3*s2 + 1) * k1.p[c] + (s3 - 2*s2 + s) * m1
+               + (-2*s3 + 3*s2) * k2.p[c] + (s3 - s2) * m2;
+    }
+    return out;
+}
+
+// Deflection tables shared by all workers, least recently used evicted first.
+class TableCache {
+public:
+    explicit TableCache(size_t capacity) : capacity(capacity) {}
+
+    shared_ptr<const DeflectionTable> get(double r0Rs, double escapeRs, atomic<int>& builds) {
+        {
+            lock_guard<mutex> lock(mtx);
+            for (auto it = tables.begin(); it != tables.end(); ++it)
+                if ((*it)->matches(r0Rs, escapeRs)) {
+                    tables.splice(tables.begin(), tables, it);
+                    return tables.front();
+                }
+        }
+        // built outside the lock; a racing duplicate build is harmless
+        auto tab = make_shared<const DeflectionTable>(DeflectionTable::build(r0Rs, escapeRs));
+        builds++;
+        lock_guard<mutex> lock(mtx);
+        tables.push_front(tab);
+        if (tables.size() > capacity) tables.pop_back();
+        return tab;
+    }
+
+private:
+    size_t capacity;
+    mutex mtx;
+    list<shared_ptr<const DeflectionTable>> tables;
+};
+
+string framePath(const string& dir, int frame, const char* ext) {
+    char name[64];
+    snprintf(name, sizeof(name), "/frame_%05d.%s", frame, ext);
+    return dir + name;
+}
+
+int main(int argc, char** argv) {
+    CliArgs args(argc, argv);
+    const double rs = schwarzschildRadius(args.num("mass", SAGA_MASS));
+    const int W = int(args.integer("width", 640));
+    const int H = int(args.integer("height", 360));
+    const uint32_t tileRows = uint32_t(std::max<long long>(1, args.integer("tile-rows", 32)));
+    const double rIn  = args.num("r-in", 2.2) * rs;
+    const double rOut = args.num("r-out", 5.2) * rs;
+    const string keyPath = args.str("keys", "");
+    const string outDir = args.str("out-dir", ".");
+
+    vector<Keyframe> keys = loadKeyframes(keyPath);
+    if (keys.empty()) {
+        cerr << "No keyframes read from '" << keyPath << "' (use --keys file)\n";
+        return EXIT_FAILURE;
+    }
+    const int firstFrame = int(std::ceil(keys.front().frame));
+    const int lastFrame = int(std::floor(keys.back().frame));
+    const int nFrames = lastFrame - firstFrame + 1;
+    const EmissionTables baseTables = EmissionTables::build(rIn, rOut, rs, 1.5e4);
+
+    // job hash: anything that changes a pixel of any frame
+    uint64_t jobHash = hashValue(W, hashValue(H, hashValue(rs, hashValue(rIn, hashValue(rOut, 0)))));
+    jobHash = hashValue(tileRows, jobHash);
+    for (const Keyframe& k : keys) jobHash = hashValue(k, jobHash);
+    const string jobPath = outDir + "/animation.job";
+    bool resume = false;
+    {
+        ifstream job(jobPath);
+        uint64_t previous = 0;
+        resume = bool(job >> previous) && previous == jobHash;
+        if (!resume && job.is_open()) // file existed but did not match
+            cerr << "[WARN] Keyframes or settings changed since the last run; re-rendering every frame\n";
+    }
+    string jobText = to_string(jobHash) + "\n";
+    if (!atomicWriteFile(jobPath, jobText.data(), jobText.size())) {
+        cerr << "Cannot write to output directory " << outDir << "\n";
+        return EXIT_FAILURE;
+    }
+
+    TableCache cache(8);
+    ThreadPool& pool = defaultPool();
+    atomic<int> framesDone{0}, framesSkipped{0}, tilesResumed{0}, tableBuilds{0}, gbufferReuses{0};
+
+    // per-slot state so consecutive frames of one worker can reuse the G-buffer
+    struct SlotState {
+        bool valid = false;
+        FrameParams geometry;
+        vector<GSample> gbuf;
+    };
+    vector<SlotState> slots(pool.size());
+
+    auto t0 = Clock::now();
+    size_t grain = std::max<size_t>(1, size_t(nFrames) / (4 * pool.size()));
+    pool.parallelFor(0, size_t(nFrames), grain, [&](size_t f0, size_t f1, unsigned slot) {
+        SlotState& st = slots[slot];
+        for (size_t fi = f0; fi < f1; ++fi) {
+            const int frame = firstFrame + int(fi);
+            const string outPath = framePath(outDir, frame, "ppm");
+            const string partPath = framePath(outDir, frame, "partial");
+            if (resume && fileExists(outPath)) { framesSkipped++; continue; }
+
+            FrameParams p = interpolate(keys, double(frame));
+            uint64_t frameHash = hashValue(p, hashValue(frame, jobHash));
+            TileCheckpoint ckpt;
+            if (resume && ckpt.load(partPath, W, H, tileRows, frameHash))
+                tilesResumed += int(ckpt.doneCount());
+            else
+                ckpt.reset(W, H, tileRows, frameHash);
+
+            ObserverView view = ObserverView::orbit(p.distance * rs, p.azimuth * GEO_PI / 180.0,
+                                                    p.elevation * GEO_PI / 180.0, p.fov, double(W) / H);
+            bool reuse = st.valid && st.geometry.sameGeometry(p);
+            shared_ptr<const DeflectionTable> table;
+            if (reuse) gbufferReuses++;
+            else {
+                double escapeRs = std::max(2.0 * rOut / rs, 1.01 * p.distance);
+                table = cache.get(p.distance, escapeRs, tableBuilds);
+                st.gbuf.assign(size_t(W) * H, GSample());
+                st.valid = false;
+            }
+
+            EmissionTables tables = baseTables;
+            tables.tMax = float(p.tMax);
+            ShadeParams sp;
+            sp.exposure = p.exposure;
+
+            bool sampledAll = true;   // tiles restored from the checkpoint are not in st.gbuf
+            for (uint32_t tile = 0; tile < ckpt.tileCount(); ++tile) {
+                if (ckpt.done[tile]) { sampledAll = false; continue; }
+                int y0 = int(tile * tileRows), y1 = std::min(H, y0 + int(tileRows));
+                if (!reuse) table->sampleRows(view, W, H, y0, y1, rs, rIn, rOut, st.gbuf);
+                shadeRGB8(st.gbuf.data(), size_t(y0) * W, size_t(y1) * W, tables, sp, ckpt.rgb.data());
+                ckpt.done[tile] = 1;
+                if (tile + 1 < ckpt.tileCount() && !ckpt.save(partPath))
+                    cerr << "[WARN] Could not write checkpoint " << partPath << "\n";
+            }
+            st.valid = reuse || sampledAll;
+            st.geometry = p;
+
+            string header = "P6\n" + to_string(W) + " " + to_string(H) + "\n255\n";
+            if (!atomicWriteFile(outPath, ckpt.rgb.data(), ckpt.rgb.size(), header)) {
+                cerr << "[WARN] Could not write " << outPath << "\n";
+                continue;
+            }
+            std::remove(partPath.c_str());
+            framesDone++;
+        }
+    });
+    double secs = chrono::duration<double>(Clock::now() - t0).count();
+
+    cout << "[INFO] Rendered " << framesDone << " frames (" << framesSkipped << " already done, "
+         << tilesResumed << " tiles resumed) in " << secs << " s; " << tableBuilds
+         << " deflection tables built, " << gbufferReuses << " G-buffers reused\n";
+    return 0;
+}
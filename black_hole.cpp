@@ -13,6 +13,17 @@
 #include <chrono>
 #include <fstream>
 #include <sstream>
+#include "emission_tables.h"
+#include "disk_volume.h"
+#include "disk_irradiation.h"
+#include "lens_grid.h"
+#include "frame_arena.h"
+#include "camera_motion.h"
+#include "task_graph.h"
+#include "gpu_nbody.h"
+#include "snapshot.h"
+#include "forecaster.h"
+#include "cli_args.h"
 #ifndef M_PI
 #define M_PI 3.14159265358979323846
 #endif
@@ -27,10 +38,14 @@ double c = 299792458.0;
 double G = 6.67430e-11;
 struct Ray;
 bool Gravity = false;
+bool VolumetricDisk = false;
+bool MultiLens = false;
+bool ShowForecast = false;
+double simTime = 0.0;   // seconds simulated by the CPU gravity loop, one per frame
 
 struct Camera {
-    // Center the camera orbit on the black hole at (0, 0, 0)
-    vec3 target = vec3(0.0f, 0.0f, 0.0f); // Always look at the black hole center
+    // Center the camera orbit on the black hole at (0, 0, 0); only a snapshot moves it
+    vec3 target = vec3(0.0f, 0.0f, 0.0f);
     float radius = 6.34194e10f;
     float minRadius = 1e10f, maxRadius = 1e12f;
 
@@ -49,16 +64,14 @@ struct Camera {
     // Calculate camera position in world space
     vec3 position() const {
         float clampedElevation = glm::clamp(elevation, 0.01f, float(M_PI) - 0.01f);
-        // Orbit around (0,0,0) always
-        return vec3(
+        // Orbit around the target
+        return target + vec3(
             radius * sin(clampedElevation) * cos(azimuth),
             radius * cos(clampedElevation),
             radius * sin(clampedElevation) * sin(azimuth)
         );
     }
     void update() {
-        // Always keep target at black hole center
-        target = vec3(0.0f, 0.0f, 0.0f);
         if(dragging | panning) {
             moving = true;
         } else {
@@ -115,40 +128,37 @@ struct Camera {
             Gravity = !Gravity;
             cout << "[INFO] Gravity turned " << (Gravity ? "ON" : "OFF") << endl;
         }
+        if (action == GLFW_PRESS && key == GLFW_KEY_V) {
+            VolumetricDisk = !VolumetricDisk;
+            cout << "[INFO] Volumetric disk " << (VolumetricDisk ? "ON" : "OFF") << endl;
+        }
+        if (action == GLFW_PRESS && key == GLFW_KEY_L) {
+            MultiLens = !MultiLens;
+            cout << "[INFO] Lensing by all masses " << (MultiLens ? "ON" : "OFF") << endl;
+        }
+        if (action == GLFW_PRESS && key == GLFW_KEY_T) {
+            ShowForecast = !ShowForecast;
+            cout << "[INFO] Trajectory forecast " << (ShowForecast ? "ON" : "OFF") << endl;
+        }
         if (action == GLFW_PRESS && key == GLFW_KEY_R) {
             // Reset camera position
-            radius = 6.34194e10f;
-            azimuth = 0.0f;
-            elevation = M_PI / 2.0f;
+            applyPreset(CAMERA_PRESETS[0]);
             cout << "[INFO] Camera reset to default position" << endl;
         }
         if (action == GLFW_PRESS && key == GLFW_KEY_P) {
-            // Toggle between different preset viewpoints
+            // Toggle between the preset viewpoints (camera_motion.h, shared with the render service's prefetcher)
             static int preset = 0;
-            preset = (preset + 1) % 3;
-            switch(preset) {
-                case 0: // Default view
-                    radius = 6.34194e10f;
-                    azimuth = 0.0f;
-                    elevation = M_PI / 2.0f;
-                    cout << "[INFO] Switched to equatorial view" << endl;
-                    break;
-                case 1: // Top-down view
-                    radius = 8.0e10f;
-                    azimuth = 0.0f;
-                    elevation = 0.3f;
-                    cout << "[INFO] Switched to polar view" << endl;
-                    break;
-                case 2: // Close-up view
-                    radius = 3.0e10f;
-                    azimuth = M_PI / 4.0f;
-                    elevation = M_PI / 3.0f;
-                    cout << "[INFO] Switched to close-up view" << endl;
-                    break;
-            }
+            preset = (preset + 1) % NUM_CAMERA_PRESETS;
+            applyPreset(CAMERA_PRESETS[preset]);
+            cout << "[INFO] Switched to " << CAMERA_PRESETS[preset].name << " view" << endl;
         }
         update();
     }
+    void applyPreset(const CameraPreset& p) {
+        radius = p.radius;
+        azimuth = p.azimuth;
+        elevation = p.elevation;
+    }
 };
 Camera camera;
 
@@ -193,11 +203,48 @@ struct Engine {
     GLuint cameraUBO = 0;
     GLuint diskUBO = 0;
     GLuint objectsUBO = 0;
+    // -- lens SSBOs (bindings 5-7), rebuilt from objects every frame -- //
+    GLuint lensGridSSBO = 0;
+    GLuint lensBodiesSSBO = 0;
+    GLuint lensMembersSSBO = 0;
+    LensGrid lensGrid;                 // rebuilt in place, keeps its capacity
+    // -- GPU n-body (--gpu-nbody): bodies stay on the GPU, lens SSBOs are built there -- //
+    bool gpuNBody = false;
+    GpuNBody nbody;
+    int nbodySubsteps = 1;
+    float nbodyDt = 1.0f;              // seconds per substep, as the CPU gravity loop's frame
+    float nbodySoftening = GpuNBody::DEFAULT_SOFTENING;   // Plummer softening (m)
     // -- grid mess vars -- //
     GLuint gridVAO = 0;
     GLuint gridVBO = 0;
     GLuint gridEBO = 0;
     int gridIndexCount = 0;
+    vector<vec3> gridVertices;         // built by buildGridMesh, uploaded by uploadGrid
+    vector<GLuint> gridIndices;
+    // -- forecast paths (forecaster.h), one line strip per body -- //
+    GLuint forecastVAO = 0;
+    GLuint forecastVBO = 0;
+    vector<GLint> forecastFirst;
+    vector<GLsizei> forecastCount;
+    // -- disk emission tables (texture units 1 and 2) -- //
+    GLuint blackbodyTex = 0;
+    GLuint diskFluxTex = 0;
+    EmissionTables emission;
+    float diskR1 = SagA.r_s * 2.2f;    // inner radius just outside the event horizon
+    float diskR2 = SagA.r_s * 5.2f;    // outer radius of the disk
+    float diskTMax = 1.5e4f;           // temperature at the flux peak (K)
+    float diskExposure = 1.5f;
+    // -- volumetric disk: density bounds on texture unit 3 -- //
+    GLuint diskOccupancyTex = 0;
+    DiskVolumeGrid diskVolume;
+    float diskThickness = 2e9f;        // Gaussian scale height (m)
+    float diskOpacity = 3.0f;          // vertical optical depth through the midplane
+    // -- disk self-irradiation on texture unit 4 -- //
+    GLuint diskIrradiationTex = 0;
+    DiskIrradiation irradiation;
+    vector<float> irradiationFlux;     // per bin, refreshed every frame
+    float irradiationEfficiency = 0.5f; // absorbed and re-emitted fraction
+    int irradiationBounces = 2;
 
     int WIDTH = 800;  // Window width
     int HEIGHT = 600; // Window height
@@ -242,9 +289,13 @@ struct Engine {
 
         glGenBuffers(1, &diskUBO);
         glBindBuffer(GL_UNIFORM_BUFFER, diskUBO);
-        glBufferData(GL_UNIFORM_BUFFER, sizeof(float) * 4, nullptr, GL_DYNAMIC_DRAW); // 3 values + 1 padding
+        glBufferData(GL_UNIFORM_BUFFER, sizeof(float) * 12, nullptr, GL_DYNAMIC_DRAW); // geometry + emission + volume params
         glBindBufferBase(GL_UNIFORM_BUFFER, 2, diskUBO); // binding = 2 matches compute shader
 
+        emission = EmissionTables::build(diskR1, diskR2, SagA.r_s, diskTMax);
+        uploadEmissionTables();
+        uploadDiskVolume();
+
         glGenBuffers(1, &objectsUBO);
         glBindBuffer(GL_UNIFORM_BUFFER, objectsUBO);
         // allocate space for 16 objects: 
@@ -260,11 +311,20 @@ struct Engine {
         this->texture = result[1];
     }
     void generateGrid(const vector<ObjectData>& objects) {
+        buildGridMesh(objects);
+        uploadGrid();
+    }
+    // CPU half of generateGrid; needs no GL context. The vectors keep their capacity between frames.
+    void buildGridMesh(const vector<ObjectData>& objects) {
         const int gridSize = 25;
         const float spacing = 1e10f;  // tweak this
 
-        vector<vec3> vertices;
-        vector<GLuint> indices;
+        vector<vec3>& vertices = gridVertices;
+        vector<GLuint>& indices = gridIndices;
+        vertices.clear();
+        indices.clear();
+        vertices.reserve((gridSize + 1) * (gridSize + 1));
+        indices.reserve(4 * gridSize * gridSize);
 
         for (int z = 0; z <= gridSize; ++z) {
             for (int x = 0; x <= gridSize; ++x) {
@@ -309,6 +369,10 @@ struct Engine {
                 indices.push_back(i + gridSize + 1);
             }
         }
+    }
+    void uploadGrid() {
+        const vector<vec3>& vertices = gridVertices;
+        const vector<GLuint>& indices = gridIndices;
 
         // 🔌 Upload to GPU
         if (gridVAO == 0) glGenVertexArrays(1, &gridVAO);
@@ -345,6 +409,37 @@ struct Engine {
         glBindVertexArray(0);
         glEnable(GL_DEPTH_TEST);
     }
+    void uploadForecast(const Forecast& forecast) {
+        vector<vec3> vertices;
+        forecastFirst.clear();
+        forecastCount.clear();
+        for (const auto& path : forecast.paths) {
+            if (path.points.size() < 2) continue;
+            forecastFirst.push_back(GLint(vertices.size()));
+            forecastCount.push_back(GLsizei(path.points.size()));
+            vertices.insert(vertices.end(), path.points.begin(), path.points.end());
+        }
+        if (forecastVAO == 0) glGenVertexArrays(1, &forecastVAO);
+        if (forecastVBO == 0) glGenBuffers(1, &forecastVBO);
+        glBindVertexArray(forecastVAO);
+        glBindBuffer(GL_ARRAY_BUFFER, forecastVBO);
+        glBufferData(GL_ARRAY_BUFFER, vertices.size() * sizeof(vec3), vertices.data(), GL_DYNAMIC_DRAW);
+        glEnableVertexAttribArray(0);
+        glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(vec3), (void*)0);
+        glBindVertexArray(0);
+    }
+    // Drawn with the grid's shader, right after the grid.
+    void drawForecast(const mat4& viewProj) {
+        if (forecastFirst.empty()) return;
+        glUseProgram(gridShaderProgram);
+        glUniformMatrix4fv(glGetUniformLocation(gridShaderProgram, "viewProj"),
+                        1, GL_FALSE, glm::value_ptr(viewProj));
+        glBindVertexArray(forecastVAO);
+        glDisable(GL_DEPTH_TEST);
+        glMultiDrawArrays(GL_LINE_STRIP, forecastFirst.data(), forecastCount.data(), GLsizei(forecastFirst.size()));
+        glBindVertexArray(0);
+        glEnable(GL_DEPTH_TEST);
+    }
     void drawFullScreenQuad() {
         glUseProgram(shaderProgram); // fragment + vertex shader
         glBindVertexArray(quadVAO);
@@ -494,6 +589,7 @@ struct Engine {
         glDeleteShader(cs);
         return prog;
     }
+    // Uploads this frame's state and traces it; rebuildLensGrid and computeIrradiation must have run.
     void dispatchCompute(const Camera& cam) {
         // determine target compute‐res
         int cw = cam.moving ? COMPUTE_WIDTH  : 200;
@@ -510,23 +606,57 @@ struct Engine {
                     GL_UNSIGNED_BYTE, 
                     nullptr);
 
-        // 2) bind compute program & UBOs
+        // 2) bodies: integrated and gridded on the GPU, or uploaded from the CPU
+        if (gpuNBody) {
+            if (Gravity) nbody.step(nbodySubsteps, nbodyDt, nbodySoftening);
+            nbody.buildLensGrid(MultiLens);
+        }
+
+        // 3) bind compute program & UBOs
         glUseProgram(computeProgram);
         uploadCameraUBO(cam);
         uploadDiskUBO();
-        uploadObjectsUBO(objects);
+        if (!gpuNBody) {
+            uploadObjectsUBO(objects);
+            uploadLensSSBOs();
+        }
+        uploadIrradiation();
 
-        // 3) bind it as image unit 0
+        // 4) bind it as image unit 0, emission tables on texture units 1 and 2, disk occupancy on 3,
+        //    irradiation on 4
         glBindImageTexture(0, texture, 0, GL_FALSE, 0, GL_WRITE_ONLY, GL_RGBA8);
+        glActiveTexture(GL_TEXTURE1);
+        glBindTexture(GL_TEXTURE_1D, blackbodyTex);
+        glActiveTexture(GL_TEXTURE2);
+        glBindTexture(GL_TEXTURE_1D, diskFluxTex);
+        glActiveTexture(GL_TEXTURE3);
+        glBindTexture(GL_TEXTURE_2D, diskOccupancyTex);
+        glActiveTexture(GL_TEXTURE4);
+        glBindTexture(GL_TEXTURE_1D, diskIrradiationTex);
+        glActiveTexture(GL_TEXTURE0);
 
-        // 4) dispatch grid
+        // 5) dispatch grid
         GLuint groupsX = (GLuint)std::ceil(cw / 16.0f);
         GLuint groupsY = (GLuint)std::ceil(ch / 16.0f);
         glDispatchCompute(groupsX, groupsY, 1);
 
-        // 5) sync
+        // 6) sync
         glMemoryBarrier(GL_SHADER_IMAGE_ACCESS_BARRIER_BIT);
     }
+    // Moves objs, followed by the point bodies `extra`, onto the GPU. Can be
+    // called again to replace them. From here on the CPU copies of objs are no
+    // longer updated.
+    void enableGpuNBody(const vector<ObjectData>& objs, const vector<GpuNBody::Body>& extra) {
+        if (!gpuNBody) nbody.init(CreateComputeProgram("nbody.comp"), CreateComputeProgram("lens_grid.comp"));
+        vector<GpuNBody::Body> bodies;
+        bodies.reserve(objs.size() + extra.size());
+        for (const auto& obj : objs)
+            bodies.push_back({ vec3(obj.posRadius), float(2.0 * G * obj.mass / (c * c)), obj.velocity });
+        bodies.insert(bodies.end(), extra.begin(), extra.end());
+        uploadObjectsUBO(objs);   // colours and radii; nbody.comp moves the spheres from here on
+        nbody.upload(bodies, objectsUBO, int(std::min(objs.size(), size_t(16))));
+        gpuNBody = true;
+    }
     void uploadCameraUBO(const Camera& cam) {
         struct UBOData {
             vec3 pos; float _pad0;
@@ -576,17 +706,114 @@ struct Engine {
         glBindBuffer(GL_UNIFORM_BUFFER, objectsUBO);
         glBufferSubData(GL_UNIFORM_BUFFER, 0, sizeof(data), &data);
     }
+    // Every object with mass lenses; tiny masses are culled in the shader. CPU only.
+    void rebuildLensGrid(const vector<ObjectData>& objs) {
+        FrameVector<vec4> posRs;
+        posRs.reserve(objs.size());
+        for (const auto& obj : objs) {
+            float r_s = float(2.0 * G * obj.mass / (c * c));
+            if (r_s > 0.0f) posRs.push_back(vec4(vec3(obj.posRadius), r_s));
+        }
+        LensGrid& grid = lensGrid;
+        grid.rebuild(posRs.data(), posRs.size(), MultiLens);
+        if (grid.bodies.empty()) grid.bodies.push_back(vec4(0.0f));   // no zero-sized buffers
+        if (grid.members.empty()) grid.members.push_back(0);
+    }
+    void uploadLensSSBOs() {
+        const LensGrid& grid = lensGrid;
+        auto upload = [](GLuint& buf, GLuint binding, GLsizeiptr size, const void* data) {
+            if (buf == 0) glGenBuffers(1, &buf);
+            glBindBuffer(GL_SHADER_STORAGE_BUFFER, buf);
+            glBufferData(GL_SHADER_STORAGE_BUFFER, size, data, GL_DYNAMIC_DRAW);
+            glBindBufferBase(GL_SHADER_STORAGE_BUFFER, binding, buf);
+        };
+        upload(lensGridSSBO, 5, sizeof(LensGrid::Block), &grid.block);
+        upload(lensBodiesSSBO, 6, grid.bodies.size() * sizeof(vec4), grid.bodies.data());
+        upload(lensMembersSSBO, 7, grid.members.size() * sizeof(int), grid.members.data());
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+    }
     void uploadDiskUBO() {
         // disk
-        float r1 = SagA.r_s * 2.2f;    // inner radius just outside the event horizon
-        float r2 = SagA.r_s * 5.2f;   // outer radius of the disk
         float num = 2.0;               // number of rays
-        float thickness = 1e9f;          // padding for std140 alignment
-        float diskData[4] = { r1, r2, num, thickness };
+        float diskData[12] = { diskR1, diskR2, num, diskThickness,
+                               emission.logTMin, emission.logTMax, emission.tMax, diskExposure,
+                               diskVolume.rMax, diskVolume.zMax, diskOpacity, VolumetricDisk ? 1.0f : 0.0f };
 
         glBindBuffer(GL_UNIFORM_BUFFER, diskUBO);
         glBufferSubData(GL_UNIFORM_BUFFER, 0, sizeof(diskData), diskData);
     }
+    void uploadEmissionTables() {
+        auto upload1D = [](GLuint& tex, GLenum internalFormat, GLenum format, int n, const float* data) {
+            if (tex == 0) glGenTextures(1, &tex);
+            glBindTexture(GL_TEXTURE_1D, tex);
+            glTexImage1D(GL_TEXTURE_1D, 0, internalFormat, n, 0, format, GL_FLOAT, data);
+            glTexParameteri(GL_TEXTURE_1D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+            glTexParameteri(GL_TEXTURE_1D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+            glTexParameteri(GL_TEXTURE_1D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+        };
+        upload1D(blackbodyTex, GL_RGB32F, GL_RGB, EmissionTables::BLACKBODY_SIZE, emission.blackbodyRGB.data());
+        upload1D(diskFluxTex, GL_R32F, GL_RED, EmissionTables::FLUX_SIZE, emission.flux.data());
+        glBindTexture(GL_TEXTURE_1D, 0);
+    }
+    // Rebuilds the (R, |y|) density bounds; nearest filtering keeps each cell's bound intact.
+    void uploadDiskVolume() {
+        diskVolume = DiskVolumeGrid::build(diskR1, diskR2, diskThickness);
+        if (diskOccupancyTex == 0) glGenTextures(1, &diskOccupancyTex);
+        glBindTexture(GL_TEXTURE_2D, diskOccupancyTex);
+        glTexImage2D(GL_TEXTURE_2D, 0, GL_R32F, DiskVolumeGrid::NR, DiskVolumeGrid::NZ, 0,
+                     GL_RED, GL_FLOAT, diskVolume.maxDensity.data());
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+        glBindTexture(GL_TEXTURE_2D, 0);
+    }
+    // Sparse mat-vec of the precomputed transfer matrix against the current flux profile;
+    // the matrix is traced on first use (or after the disk radii change). CPU only.
+    void computeIrradiation() {
+        if (!irradiation.matches(diskR1, diskR2, SagA.r_s))
+            irradiation = DiskIrradiation::build(diskR1, diskR2, SagA.r_s);
+        FrameVector<float> F(DiskIrradiation::BINS);
+        irradiation.binFlux(emission, F.data());
+        irradiation.illuminate(F.data(), irradiationBounces, irradiationEfficiency, irradiationFlux);
+    }
+    void uploadIrradiation() {
+        bool create = diskIrradiationTex == 0;
+        if (create) glGenTextures(1, &diskIrradiationTex);
+        glBindTexture(GL_TEXTURE_1D, diskIrradiationTex);
+        if (create) {
+            glTexImage1D(GL_TEXTURE_1D, 0, GL_R32F, DiskIrradiation::BINS, 0, GL_RED, GL_FLOAT, irradiationFlux.data());
+            glTexParameteri(GL_TEXTURE_1D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+            glTexParameteri(GL_TEXTURE_1D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+            glTexParameteri(GL_TEXTURE_1D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+        } else {
+            glTexSubImage1D(GL_TEXTURE_1D, 0, 0, DiskIrradiation::BINS, GL_RED, GL_FLOAT, irradiationFlux.data());
+        }
+        glBindTexture(GL_TEXTURE_1D, 0);
+    }
+    // Loads a cached transfer matrix, or traces one for the current disk and writes it.
+    bool loadIrradiation(const string& path, bool& traced) {
+        DiskIrradiation loaded;
+        traced = !(loaded.load(path) && loaded.matches(diskR1, diskR2, SagA.r_s));
+        if (traced) {
+            irradiation = DiskIrradiation::build(diskR1, diskR2, SagA.r_s);
+            return irradiation.save(path);
+        }
+        irradiation = loaded;
+        return true;
+    }
+    // Replaces the startup tables with a cached file; the file's disk radii win.
+    bool loadEmissionTables(const string& path) {
+        EmissionTables loaded;
+        if (!loaded.load(path)) return false;
+        emission = loaded;
+        diskR1 = emission.rIn;
+        diskR2 = emission.rOut;
+        diskTMax = emission.tMax;
+        uploadEmissionTables();
+        uploadDiskVolume();
+        return true;
+    }
     
     vector<GLuint> QuadVAO(){
         float quadVertices[] = {
@@ -644,6 +871,99 @@ struct Engine {
     };
 };
 Engine engine;
+
+// -- snapshots (snapshot.h): F5 saves the scene in the background, F9 restores it -- //
+string snapshotPath = "black_hole.snap";
+SnapshotWriter snapshotWriter([](const string& path, size_t bodies, bool ok, double ms) {
+    if (ok) cout << "[INFO] Saved " << bodies << " bodies to " << path << " in " << ms << " ms" << endl;
+    else cerr << "[WARN] Could not write snapshot " << path << endl;
+});
+void saveSnapshot() {
+    // GPU bodies are read back once here; the CPU objects still hold their radii and colours
+    vector<vec4> pos, vel;
+    if (engine.gpuNBody) {
+        pos = engine.nbody.positions();
+        vel = engine.nbody.velocities();
+    }
+    size_t n = engine.gpuNBody ? pos.size() : objects.size();
+    Snapshot s;
+    s.resize(n);
+    for (size_t i = 0; i < n; ++i) {
+        vec3 p = engine.gpuNBody ? vec3(pos[i]) : vec3(objects[i].posRadius);
+        vec3 v = engine.gpuNBody ? vec3(vel[i]) : objects[i].velocity;
+        for (int k = 0; k < 3; ++k) {
+            s.field[SNAP_POS_X + k][i] = p[k];
+            s.field[SNAP_VEL_X + k][i] = v[k];
+        }
+        if (i < objects.size()) {
+            const ObjectData& obj = objects[i];
+            s.field[SNAP_MASS][i] = obj.mass;
+            s.field[SNAP_RADIUS][i] = obj.posRadius.w;
+            uvec4 rgba = uvec4(clamp(obj.color, 0.0f, 1.0f) * 255.0f + 0.5f);
+            s.color[i] = rgba.r | rgba.g << 8 | rgba.b << 16 | rgba.a << 24;
+        } else {
+            s.field[SNAP_MASS][i] = float(pos[i].w * c * c / (2.0 * G));
+        }
+    }
+    s.scene.holeMass = SagA.mass;
+    s.scene.holeRs = SagA.r_s;
+    s.scene.camRadius = camera.radius;
+    s.scene.camAzimuth = camera.azimuth;
+    s.scene.camElevation = camera.elevation;
+    for (int k = 0; k < 3; ++k) s.scene.camTarget[k] = camera.target[k];
+    s.scene.flags = (Gravity ? SNAP_GRAVITY : 0) | (MultiLens ? SNAP_MULTILENS : 0)
+                  | (VolumetricDisk ? SNAP_VOLUMETRIC : 0) | (engine.gpuNBody ? SNAP_GPU_NBODY : 0);
+    snapshotWriter.save(std::move(s), snapshotPath);
+}
+// Drawn bodies (radius > 0) come first and become objects; the point bodies
+// after them go to the GPU n-body, which is switched on if needed.
+bool loadSnapshot(const string& path) {
+    auto t0 = Clock::now();
+    MappedSnapshot snap;
+    string error;
+    if (!snap.open(path, error)) {
+        cerr << "[WARN] Could not load snapshot " << path << ": " << error << endl;
+        return false;
+    }
+    const SnapshotScene& scene = snap.scene();
+    if (std::abs(scene.holeMass / SagA.mass - 1.0) > 1e-6)
+        cerr << "[WARN] Snapshot was taken around a " << scene.holeMass << " kg black hole; keeping "
+             << SagA.mass << " kg" << endl;
+    const float* f[SNAP_COLOR];
+    for (uint32_t k = 0; k < SNAP_COLOR; ++k) f[k] = snap.field(SnapshotField(k));
+    const uint32_t* color = snap.colors();
+    auto get = [&](int k, size_t i) { return f[k] ? f[k][i] : 0.0f; };
+
+    vector<ObjectData> restored;
+    vector<GpuNBody::Body> points;
+    for (size_t i = 0; i < snap.size(); ++i) {
+        vec3 p(get(SNAP_POS_X, i), get(SNAP_POS_Y, i), get(SNAP_POS_Z, i));
+        vec3 v(get(SNAP_VEL_X, i), get(SNAP_VEL_Y, i), get(SNAP_VEL_Z, i));
+        float mass = get(SNAP_MASS, i), radius = get(SNAP_RADIUS, i);
+        if (radius > 0.0f && points.empty()) {
+            uint32_t rgba = color ? color[i] : 0xffffffffu;
+            vec4 col = vec4(rgba & 255, rgba >> 8 & 255, rgba >> 16 & 255, rgba >> 24) / 255.0f;
+            restored.push_back({ vec4(p, radius), col, mass, v });
+        } else {
+            points.push_back({ p, float(2.0 * G * mass / (c * c)), v });
+        }
+    }
+    objects = std::move(restored);
+    camera.radius = scene.camRadius;
+    camera.azimuth = scene.camAzimuth;
+    camera.elevation = scene.camElevation;
+    camera.target = vec3(scene.camTarget[0], scene.camTarget[1], scene.camTarget[2]);
+    camera.update();
+    Gravity = scene.flags & SNAP_GRAVITY;
+    MultiLens = scene.flags & SNAP_MULTILENS;
+    VolumetricDisk = scene.flags & SNAP_VOLUMETRIC;
+    if (engine.gpuNBody || !points.empty() || (scene.flags & SNAP_GPU_NBODY))
+        engine.enableGpuNBody(objects, points);
+    cout << "[INFO] Restored " << snap.size() << " bodies from " << path << " in "
+         << chrono::duration<double, milli>(Clock::now() - t0).count() << " ms" << endl;
+    return true;
+}
+
 void setupCameraCallbacks(GLFWwindow* window) {
     glfwSetWindowUserPointer(window, &camera);
 
@@ -665,12 +985,70 @@ void setupCameraCallbacks(GLFWwindow* window) {
     glfwSetKeyCallback(window, [](GLFWwindow* win, int key, int scancode, int action, int mods) {
         Camera* cam = (Camera*)glfwGetWindowUserPointer(win);
         cam->processKey(key, scancode, action, mods);
+        if (action == GLFW_PRESS && key == GLFW_KEY_F5) saveSnapshot();
+        if (action == GLFW_PRESS && key == GLFW_KEY_F9) loadSnapshot(snapshotPath);
     });
 }
 
 
 // -- MAIN -- //
-int main() {
+int main(int argc, char** argv) {
+    CliArgs args(argc, argv);
+    if (args.has("emission-tables")) {
+        string path = args.str("emission-tables", "");
+        if (engine.loadEmissionTables(path))
+            cout << "[INFO] Loaded emission tables from " << path << endl;
+        else if (engine.emission.save(path))
+            cout << "[INFO] Wrote emission tables to " << path << endl;
+        else
+            cerr << "[WARN] Could not read or write emission tables " << path << endl;
+    }
+    // Extra black holes: "x,y,z,mass;..." with positions in SagA radii and masses in SagA masses
+    if (args.has("black-holes")) {
+        stringstream all(args.str("black-holes", ""));
+        string item;
+        while (getline(all, item, ';')) {
+            float x, y, z, m;
+            if (sscanf(item.c_str(), "%f,%f,%f,%f", &x, &y, &z, &m) != 4 || m <= 0.0f) {
+                cerr << "[WARN] Ignoring malformed black hole: " << item << endl;
+                continue;
+            }
+            float mass = float(SagA.mass) * m;
+            float r_s = float(2.0 * G * mass / (c * c));
+            objects.push_back({ vec4(vec3(x, y, z) * float(SagA.r_s), r_s), vec4(0,0,0,1), mass });
+        }
+        MultiLens = true;
+    }
+    // GPU n-body: --gpu-nbody [--nbody-cloud N] [--nbody-substeps K] [--nbody-softening m]
+    if (args.has("nbody-selftest")) {
+        GpuNBody nb;
+        nb.init(engine.CreateComputeProgram("nbody.comp"), engine.CreateComputeProgram("lens_grid.comp"));
+        bool ok = gpuNBodySelfTest(nb, int(args.integer("nbody-selftest", 4096)), int(args.integer("nbody-steps", 10)),
+                                   SagA.r_s, float(args.num("nbody-softening", GpuNBody::DEFAULT_SOFTENING)));
+        glfwTerminate();
+        return ok ? 0 : 1;
+    }
+    if (args.has("gpu-nbody") || args.has("nbody-cloud")) {
+        engine.nbodySubsteps = std::max(1, int(args.integer("nbody-substeps", 1)));
+        engine.nbodyDt = engine.nbodyDt / engine.nbodySubsteps;
+        engine.nbodySoftening = float(args.num("nbody-softening", GpuNBody::DEFAULT_SOFTENING));
+        engine.enableGpuNBody(objects, GpuNBody::cloud(int(args.integer("nbody-cloud", 0)), SagA.r_s, 3e11f, 6e11f, 1234u));
+        cout << "[INFO] GPU n-body: " << engine.nbody.count() << " bodies, " << engine.nbodySubsteps
+             << " substep(s) per frame" << endl;
+    }
+    // Snapshots: F5/F9 use --snapshot (default black_hole.snap); --load-snapshot restores one at start
+    snapshotPath = args.str("snapshot", args.str("load-snapshot", snapshotPath));
+    if (args.has("load-snapshot") && !loadSnapshot(args.str("load-snapshot", "")))
+        cerr << "[WARN] Starting from the built-in scene" << endl;
+    if (args.has("irradiation-cache")) {
+        string path = args.str("irradiation-cache", "");
+        bool traced = false;
+        if (!engine.loadIrradiation(path, traced))
+            cerr << "[WARN] Could not write irradiation matrix " << path << endl;
+        else
+            cout << "[INFO] " << (traced ? "Wrote" : "Loaded") << " irradiation matrix "
+                 << (traced ? "to " : "from ") << path << endl;
+    }
     setupCameraCallbacks(engine.window);
     vector<unsigned char> pixels(engine.WIDTH * engine.HEIGHT * 3);
 
@@ -679,58 +1057,81 @@ int main() {
 
     double lastTime = glfwGetTime();
     int   renderW  = 800, renderH = 600, numSteps = 80000;
-    while (!glfwWindowShouldClose(engine.window)) {
-        glClearColor(0.0f, 0.0f, 0.0f, 1.0f);  // optional, but good practice
-        glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
-        double now   = glfwGetTime();
-        double dt    = now - lastTime;   // seconds since last frame
-        lastTime     = now;
-
-        // Gravity
-        for (auto& obj : objects) {
-            for (auto& obj2 : objects) {
-                if (&obj == &obj2) continue; // skip self-interaction
-                 float dx  = obj2.posRadius.x - obj.posRadius.x;
-                 float dy = obj2.posRadius.y - obj.posRadius.y;
-                 float dz = obj2.posRadius.z - obj.posRadius.z;
-                 float distance = sqrt(dx * dx + dy * dy + dz * dz);
-                 if (distance > 0) {
-                        vector<double> direction = {dx / distance, dy / distance, dz / distance};
-                        //distance *= 1000;
-                        double Gforce = (G * obj.mass * obj2.mass) / (distance * distance);
-
-                        double acc1 = Gforce / obj.mass;
-                        std::vector<double> acc = {direction[0] * acc1, direction[1] * acc1, direction[2] * acc1};
-                        if (Gravity) {
-                            obj.velocity.x += acc[0];
-                            obj.velocity.y += acc[1];
-                            obj.velocity.z += acc[2];
-
-                            obj.posRadius.x += obj.velocity.x;
-                            obj.posRadius.y += obj.velocity.y;
-                            obj.posRadius.z += obj.velocity.z;
-                            cout << "velocity: " <<obj.velocity.x<<", " <<obj.velocity.y<<", " <<obj.velocity.z<<endl;
-                        }
-                    }
+    // Future paths of the objects (T key), integrated in the background
+    ForecastOptions forecastOptions;
+    forecastOptions.horizon = args.num("forecast-horizon", forecastOptions.horizon);
+    forecastOptions.chunk = forecastOptions.horizon / 20.0;
+    TrajectoryForecaster forecaster(forecastOptions);
+    vector<ForecastBody> forecastBodies;
+    Forecast forecast;
+    if (args.has("forecast")) ShowForecast = true;
+
+    // One frame's work. CPU stages run on the pool as soon as their inputs
+    // are ready; the GL stages run here, on the context thread, in this order.
+    TaskGraph frame;
+    mat4 viewProj;
+    int gravity = frame.add("gravity", [] {
+        if (engine.gpuNBody) return;   // integrated by nbody.comp in dispatchCompute
+        if (!Gravity) return;
+        simTime += 1.0;
+        // one 1 s step: kick every body from the same positions, then drift each
+        // once, like a step of the forecaster (forecaster.h)
+        FrameArena::Scope scratch(threadFrameArena());
+        FrameVector<dvec3> acc(objects.size(), dvec3(0.0));
+        for (size_t i = 0; i < objects.size(); ++i)
+            for (size_t j = 0; j < objects.size(); ++j) {
+                if (i == j) continue; // skip self-interaction
+                dvec3 d = dvec3(vec3(objects[j].posRadius)) - dvec3(vec3(objects[i].posRadius));
+                double distance = length(d);
+                if (distance > 0) acc[i] += d * (G * objects[j].mass / (distance * distance * distance));
             }
+        for (size_t i = 0; i < objects.size(); ++i) {
+            objects[i].velocity += vec3(acc[i]);
+            objects[i].posRadius += vec4(objects[i].velocity, 0.0f);
         }
-
-
-
-        // ---------- GRID ------------- //
-        // 2) rebuild grid mesh on CPU
-        engine.generateGrid(objects);
-        // 5) overlay the bent grid
+    });
+    // ---------- CPU ------------- //
+    int gridMesh = frame.add("grid mesh", [&] { engine.buildGridMesh(objects); }, { gravity });
+    int lenses = frame.add("lens grid", [&] {
+        if (!engine.gpuNBody) engine.rebuildLensGrid(objects);   // else lens_grid.comp builds it
+    }, { gravity });
+    int irradiance = frame.add("irradiation", [&] { engine.computeIrradiation(); });
+    int camMatrix = frame.add("view-projection", [&] {
         mat4 view = lookAt(camera.position(), camera.target, vec3(0,1,0));
         mat4 proj = perspective(radians(60.0f), float(engine.COMPUTE_WIDTH)/engine.COMPUTE_HEIGHT, 1e9f, 1e14f);
-        mat4 viewProj = proj * view;
-        engine.drawGrid(viewProj);
-
-        // ---------- RUN RAYTRACER ------------- //
+        viewProj = proj * view;
+    });
+    // ---------- GL ------------- //
+    int grid = frame.add("grid draw", [&] {
+        engine.uploadGrid();
+        engine.drawGrid(viewProj);   // overlay the bent grid
+        if (ShowForecast && !engine.gpuNBody) {
+            // only compares with the running forecast; integration happens on the forecaster's thread
+            forecastBodies.clear();
+            for (const auto& obj : objects)
+                forecastBodies.push_back({ dvec3(vec3(obj.posRadius)), dvec3(obj.velocity), G * obj.mass, obj.posRadius.w });
+            forecaster.update(forecastBodies, simTime);
+            if (forecaster.latest(forecast)) engine.uploadForecast(forecast);
+            engine.drawForecast(viewProj);
+        }
+    }, { gridMesh, camMatrix }, TaskGraph::On::Caller);
+    frame.add("raytrace", [&] {
         glViewport(0, 0, engine.WIDTH, engine.HEIGHT);
         engine.dispatchCompute(camera);
         engine.drawFullScreenQuad();
+    }, { grid, lenses, irradiance }, TaskGraph::On::Caller);
+
+    while (!glfwWindowShouldClose(engine.window)) {
+        threadFrameArena().reset();   // last frame's scratch is dead
+        glClearColor(0.0f, 0.0f, 0.0f, 1.0f);  // optional, but good practice
+        glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+
+        double now   = glfwGetTime();
+        double dt    = now - lastTime;   // seconds since last frame
+        lastTime     = now;
+
+        frame.run();
 
         // 6) present to screen
         glfwSwapBuffers(engine.window);
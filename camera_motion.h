@@ -0,0 +1,103 @@
+#pragma once
+// Orbit-camera presets and short-term camera motion prediction.
+//
+// CAMERA_PRESETS are the viewpoints black_hole.cpp cycles through with P
+// (the first is also where R resets to). MotionPredictor watches the stream
+// of poses one client asks for — an orbit drag moves azimuth/elevation by a
+// steady step per frame, a scroll moves the radius by whole notches — and
+// guesses the poses that come next: the current motion extrapolated a few
+// steps, then the presets, next-in-cycle first. Renderers use the guesses to
+// trace ahead while they would otherwise be idle.
+#include <algorithm>
+#include <cmath>
+#include <deque>
+#include <vector>
+
+struct CameraPose {
+    double radius = 0.0;      // orbit radius (any unit, as long as it is consistent)
+    double azimuth = 0.0;     // radians
+    double elevation = 0.0;   // radians from +y, the disk normal
+};
+
+struct CameraPreset {
+    const char* name;
+    float radius;             // meters
+    float azimuth, elevation;
+};
+
+inline constexpr CameraPreset CAMERA_PRESETS[] = {
+    { "equatorial", 6.34194e10f, 0.0f,           1.57079632679f },   // π/2
+    { "polar",      8.0e10f,     0.0f,           0.3f },
+    { "close-up",   3.0e10f,     0.78539816339f, 1.04719755120f },   // π/4, π/3
+};
+inline constexpr int NUM_CAMERA_PRESETS = sizeof(CAMERA_PRESETS) / sizeof(CAMERA_PRESETS[0]);
+
+class MotionPredictor {
+public:
+    // Poses further apart than this in time belong to different motions.
+    explicit MotionPredictor(double gapSeconds = 1.0) : gap(gapSeconds) {}
+
+    void record(const CameraPose& p, double t) {
+        if (!history.empty()) {
+            // unwrap azimuth so a drag across ±π keeps a steady step
+            double prev = history.back().pose.azimuth;
+            CameraPose q = p;
+            q.azimuth = prev + std::remainder(p.azimuth - prev, 2.0 * PI);
+            if (t - history.back().t > gap) history.clear();
+            else if (near(q, history.back().pose, 1e-9)) { history.back().t = t; return; }   // same pose again
+            history.push_back({ q, t });
+        } else {
+            history.push_back({ p, t });
+        }
+        while (history.size() > HISTORY) history.pop_front();
+    }
+
+    // Up to `ahead` extrapolated poses (nearest first) while the camera is
+    // moving, followed by the presets (scaled by presetScale into the
+    // caller's radius unit) that differ from the current pose.
+    std::vector<CameraPose> predict(int ahead, double presetScale) const {
+        std::vector<CameraPose> out;
+        if (history.empty()) return out;
+        const CameraPose& last = history.back().pose;
+        if (history.size() >= 2 && ahead > 0) {
+            // mean step of the recent poses; the radius moves geometrically so zooms stay proportional
+            size_t n = std::min<size_t>(history.size(), 4);
+            const CameraPose& first = history[history.size() - n].pose;
+            double dAz = (last.azimuth - first.azimuth) / double(n - 1);
+            double dEl = (last.elevation - first.elevation) / double(n - 1);
+            double dLogR = std::log(last.radius / first.radius) / double(n - 1);
+            if (std::abs(dAz) + std::abs(dEl) + std::abs(dLogR) > 1e-6)
+                for (int k = 1; k <= ahead; ++k) {
+                    CameraPose q;
+                    q.radius = last.radius * std::exp(k * dLogR);
+                    q.azimuth = last.azimuth + k * dAz;
+                    q.elevation = std::clamp(last.elevation + k * dEl, 0.01, PI - 0.01);
+                    out.push_back(q);
+                }
+        }
+        int at = -1;
+        for (int i = 0; i < NUM_CAMERA_PRESETS; ++i)
+            if (near(last, preset(i, presetScale))) at = i;
+        for (int k = 1; k <= NUM_CAMERA_PRESETS; ++k) {
+            int i = (at + k) % NUM_CAMERA_PRESETS;
+            if (i != at) out.push_back(preset(i, presetScale));
+        }
+        return out;
+    }
+
+    static CameraPose preset(int i, double scale) {
+        return { CAMERA_PRESETS[i].radius * scale, CAMERA_PRESETS[i].azimuth, CAMERA_PRESETS[i].elevation };
+    }
+
+private:
+    static bool near(const CameraPose& a, const CameraPose& b, double tol = 1e-3) {
+        return std::abs(a.radius / b.radius - 1.0) < tol && std::abs(a.elevation - b.elevation) < tol
+            && std::abs(std::remainder(a.azimuth - b.azimuth, 2.0 * PI)) < tol;
+    }
+
+    static constexpr double PI = 3.14159265358979323846;
+    static constexpr size_t HISTORY = 8;
+    struct Sample { CameraPose pose; double t; };
+    std::deque<Sample> history;
+    double gap;
+};
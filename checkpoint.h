@@ -0,0 +1,87 @@
+#pragma once
+// Crash-safe output for long headless jobs.
+//
+// Files are written to "<path>.tmp" and renamed over the target, so a killed
+// job leaves either the old file or the new one, never a torn one. A
+// TileCheckpoint records which row tiles of an 8-bit RGB image are finished
+// together with their pixels; it is tagged with a hash of everything that
+// determines the image, so a resumed job never mixes tiles of different
+// parameters.
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <vector>
+
+inline bool atomicWriteFile(const std::string& path, const void* data, size_t bytes,
+                            const std::string& header = "") {
+    std::string tmp = path + ".tmp";
+    FILE* f = std::fopen(tmp.c_str(), "wb");
+    if (!f) return false;
+    bool ok = std::fwrite(header.data(), 1, header.size(), f) == header.size()
+           && std::fwrite(data, 1, bytes, f) == bytes;
+    ok = (std::fclose(f) == 0) && ok;
+    if (!ok) { std::remove(tmp.c_str()); return false; }
+    return std::rename(tmp.c_str(), path.c_str()) == 0;
+}
+
+inline bool fileExists(const std::string& path) {
+    FILE* f = std::fopen(path.c_str(), "rb");
+    if (f) std::fclose(f);
+    return f != nullptr;
+}
+
+// FNV-1a over raw bytes; chain calls to hash several fields.
+inline uint64_t hashBytes(const void* data, size_t bytes, uint64_t h = 1469598103934665603ull) {
+    const unsigned char* p = static_cast<const unsigned char*>(data);
+    for (size_t i = 0; i < bytes; ++i) { h ^= p[i]; h *= 1099511628211ull; }
+    return h;
+}
+template <class T> inline uint64_t hashValue(const T& v, uint64_t h) { return hashBytes(&v, sizeof(T), h); }
+
+struct TileCheckpoint {
+    uint32_t width = 0, height = 0, tileRows = 0;
+    uint64_t hash = 0;
+    std::vector<uint8_t> done;          // one flag per row tile
+    std::vector<unsigned char> rgb;     // width × height × 3
+
+    void reset(uint32_t w, uint32_t h, uint32_t rows, uint64_t paramHash) {
+        width = w; height = h; tileRows = rows; hash = paramHash;
+        done.assign(tileCount(), 0);
+        rgb.assign(size_t(w) * h * 3, 0);
+    }
+    uint32_t tileCount() const { return tileRows ? (height + tileRows - 1) / tileRows : 0; }
+    uint32_t doneCount() const { uint32_t n = 0; for (uint8_t d : done) n += d; return n; }
+
+    bool save(const std::string& path) const {
+        std::string head(8 + 3 * sizeof(uint32_t) + sizeof(uint64_t), '\0');
+        char* p = &head[0];
+        std::memcpy(p, "BHPART01", 8); p += 8;
+        std::memcpy(p, &width, 4); p += 4;
+        std::memcpy(p, &height, 4); p += 4;
+        std::memcpy(p, &tileRows, 4); p += 4;
+        std::memcpy(p, &hash, 8);
+        head.append(reinterpret_cast<const char*>(done.data()), done.size());
+        return atomicWriteFile(path, rgb.data(), rgb.size(), head);
+    }
+
+    // Loads path if it exists and was written for the same image and parameters.
+    bool load(const std::string& path, uint32_t w, uint32_t h, uint32_t rows, uint64_t paramHash) {
+        FILE* f = std::fopen(path.c_str(), "rb");
+        if (!f) return false;
+        char magic[8];
+        uint32_t dims[3];
+        uint64_t fileHash;
+        bool ok = std::fread(magic, 1, 8, f) == 8 && std::memcmp(magic, "BHPART01", 8) == 0
+               && std::fread(dims, 4, 3, f) == 3 && std::fread(&fileHash, 8, 1, f) == 1
+               && dims[0] == w && dims[1] == h && dims[2] == rows && fileHash == paramHash;
+        if (ok) {
+            reset(w, h, rows, paramHash);
+            ok = std::fread(done.data(), 1, done.size(), f) == done.size()
+              && std::fread(rgb.data(), 1, rgb.size(), f) == rgb.size();
+        }
+        std::fclose(f);
+        if (!ok) reset(w, h, rows, paramHash);
+        return ok;
+    }
+};
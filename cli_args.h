@@ -0,0 +1,38 @@
+#pragma once
+// Minimal "--key value" / "--flag" parser for the headless tools.
+#include <cstdlib>
+#include <iostream>
+#include <map>
+#include <string>
+
+struct CliArgs {
+    std::map<std::string, std::string> values;
+
+    CliArgs(int argc, char** argv) {
+        for (int i = 1; i < argc; ++i) {
+            std::string key = argv[i];
+            if (key.rfind("--", 0) != 0) {
+                std::cerr << "Ignoring stray argument: " << key << "\n";
+                continue;
+            }
+            key = key.substr(2);
+            if (i + 1 < argc && std::string(argv[i + 1]).rfind("--", 0) != 0)
+                values[key] = argv[++i];
+            else
+                values[key] = "1";
+        }
+    }
+    bool has(const std::string& key) const { return values.count(key) != 0; }
+    std::string str(const std::string& key, const std::string& def) const {
+        auto it = values.find(key);
+        return it == values.end() ? def : it->second;
+    }
+    double num(const std::string& key, double def) const {
+        auto it = values.find(key);
+        return it == values.end() ? def : std::strtod(it->second.c_str(), nullptr);
+    }
+    long long integer(const std::string& key, long long def) const {
+        auto it = values.find(key);
+        return it == values.end() ? def : std::strtoll(it->second.c_str(), nullptr, 10);
+    }
+};
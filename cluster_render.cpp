@@ -0,0 +1,400 @@
+// Coordinator/worker tile renderer for stills too large for one machine.
+//
+// The coordinator splits the frame into square tiles, estimates each tile's
+// cost from a few probe geodesics (integration steps × pixels), and hands the
+// most expensive tiles out first to whichever worker has a free pipeline slot
+// (longest-processing-time list scheduling). Workers trace their tiles with
+// the CPU geodesic tracer, shade them with the emission tables and send back
+// 8-bit RGB. A worker whose socket closes, or that stays silent for
+// --timeout seconds while holding tiles, is dropped and its tiles go back to
+// the queue; spawned workers are replaced.
+//
+//   # everything on this machine, four single-threaded workers
+//   BlackHoleCluster --spawn 4 --width 7680 --height 4320 --out still.ppm
+//
+//   # workers on other hosts join a TCP coordinator
+//   BlackHoleCluster --listen tcp:0.0.0.0:7070 --width 15360 --height 8640 --out big.ppm
+//   BlackHoleCluster --worker --connect tcp:render01:7070
+//
+// Scene flags are those of BlackHoleRender and only the coordinator reads
+// them; workers receive the job over the socket. POSIX only.
+#include "geodesic_core.h"
+#include "observer.h"
+#include "gbuffer.h"
+#include "emission_tables.h"
+#include "disk_shading.h"
+#include "parallel.h"
+#include "cli_args.h"
+#include "image_io.h"
+#include "socket_io.h"
+#include <poll.h>
+#include <signal.h>
+#include <sys/wait.h>
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <queue>
+#include <string>
+#include <thread>
+#include <vector>
+using namespace std;
+using Clock = std::chrono::steady_clock;
+
+enum MessageType : uint32_t {
+    MSG_HELLO = 1,   // worker → coordinator: WorkerHello
+    MSG_JOB,         // coordinator → worker: ClusterJob
+    MSG_TILE,        // coordinator → worker: TileRect
+    MSG_RESULT,      // worker → coordinator: TileRect + w·h·3 bytes RGB
+    MSG_HEARTBEAT,   // worker → coordinator while rendering
+    MSG_BYE          // coordinator → worker: exit
+};
+
+// Everything a worker needs to render any tile of the frame.
+struct ClusterJob {
+    int32_t width, height;
+    double mass, distance, azimuth, inclination, fov;   // as BlackHoleRender: rs, radians, degrees
+    double rInRs, rOutRs, tMax, exposure, stepScale;
+};
+
+struct TileRect {
+    int32_t id, x0, y0, w, h;
+};
+
+struct WorkerHello {
+    int32_t pid, threads;
+};
+static const double HELLO_TIMEOUT = 5.0;   // seconds a new connection gets to send MSG_HELLO
+
+// Scene state derived from a ClusterJob, identical on every process.
+struct ClusterScene {
+    ClusterJob job;
+    double rs;
+    ObserverView view;
+    TraceParams tp;
+    EmissionTables tables;
+    ShadeParams sp;
+
+    explicit ClusterScene(const ClusterJob& j) : job(j) {
+        rs = schwarzschildRadius(j.mass);
+        view = ObserverView::orbit(j.distance * rs, j.azimuth, j.inclination * GEO_PI / 180.0,
+                                   j.fov, double(j.width) / j.height);
+        tables = EmissionTables::build(j.rInRs * rs, j.rOutRs * rs, rs, j.tMax);
+        tp.rs = rs;
+        tp.escapeRadius = std::max(2.0 * double(tables.rOut), 1.01 * glm::length(view.pos));
+        tp.stepScale = j.stepScale;
+        tp.diskInner = tables.rIn;
+        tp.diskOuter = tables.rOut;
+        tp.stopAtDisk = true;
+        sp.exposure = j.exposure;
+    }
+
+    glm::dvec3 pixelDir(int x, int y) const { return view.pixelDir(x, double(y), job.width, job.height); }
+};
+
+// ---------------------------------------------------------------- worker -- //
+
+int runWorker(const CliArgs& args) {
+    Endpoint ep;
+    if (!Endpoint::parse(args.str("connect", ""), ep)) {
+        cerr << "Worker needs --connect tcp:host:port or --connect unix:/path\n";
+        return EXIT_FAILURE;
+    }
+    int fd = -1;
+    for (int attempt = 0; attempt < 50 && fd < 0; ++attempt) {   // coordinator may still be starting
+        fd = connectTo(ep);
+        if (fd < 0) this_thread::sleep_for(chrono::milliseconds(200));
+    }
+    if (fd < 0) {
+        cerr << "Cannot connect to " << ep.str() << "\n";
+        return EXIT_FAILURE;
+    }
+    ThreadPool pool(unsigned(args.integer("threads", 0)));
+    WorkerHello hello{ int32_t(getpid()), int32_t(pool.size()) };
+    mutex sendMutex;
+    sendMessage(fd, MSG_HELLO, &hello, sizeof(hello));
+
+    unique_ptr<ClusterScene> scene;
+    vector<GSample> samples;
+    vector<char> reply, payload;
+    uint32_t type;
+    while (recvMessage(fd, type, payload)) {
+        if (type == MSG_BYE) break;
+        if (type == MSG_JOB && payload.size() == sizeof(ClusterJob)) {
+            ClusterJob job;
+            memcpy(&job, payload.data(), sizeof(job));
+            scene.reset(new ClusterScene(job));
+            continue;
+        }
+        if (type != MSG_TILE || !scene || payload.size() != sizeof(TileRect)) continue;
+
+        TileRect t;
+        memcpy(&t, payload.data(), sizeof(t));
+        // heartbeats keep a slow tile from looking like a dead worker
+        atomic<bool> rendering{true};
+        thread beat([&] {
+            while (rendering) {
+                for (int i = 0; i < 10 && rendering; ++i) this_thread::sleep_for(chrono::milliseconds(100));
+                lock_guard<mutex> lock(sendMutex);
+                if (rendering) sendMessage(fd, MSG_HEARTBEAT, nullptr, 0);
+            }
+        });
+        samples.assign(size_t(t.w) * t.h, GSample());
+        pool.parallelFor(0, size_t(t.h), 1, [&](size_t r0, size_t r1, unsigned) {
+            for (size_t r = r0; r < r1; ++r)
+                for (int x = 0; x < t.w; ++x)
+                    samples[r * t.w + x] = traceSample(scene->view, scene->pixelDir(t.x0 + x, t.y0 + int(r)), scene->tp);
+        });
+        rendering = false;
+        beat.join();
+
+        reply.resize(sizeof(TileRect) + samples.size() * 3);
+        memcpy(reply.data(), &t, sizeof(t));
+        shadeRGB8(samples.data(), 0, samples.size(), scene->tables, scene->sp,
+                  reinterpret_cast<unsigned char*>(reply.data() + sizeof(TileRect)));
+        lock_guard<mutex> lock(sendMutex);
+        if (!sendMessage(fd, MSG_RESULT, reply.data(), uint32_t(reply.size()))) break;
+    }
+    close(fd);
+    return 0;
+}
+
+// ----------------------------------------------------------- coordinator -- //
+
+struct Tile {
+    TileRect rect;
+    double cost = 0.0;
+    bool done = false;
+};
+
+struct WorkerConn {
+    int fd = -1;
+    pid_t pid = -1;          // child process when spawned here
+    bool spawned = false;
+    MessageBuffer in;
+    vector<int> inFlight;    // tile ids
+    Clock::time_point lastHeard;
+    int tilesDone = 0;
+    int threads = 1;
+};
+
+pid_t spawnWorker(const char* self, const Endpoint& ep, int threads) {
+    pid_t pid = fork();
+    if (pid != 0) return pid;
+    string connect = ep.str(), nthreads = to_string(threads);
+    execlp(self, self, "--worker", "--connect", connect.c_str(), "--threads", nthreads.c_str(), (char*)nullptr);
+    _exit(127);
+}
+
+// Mean integration steps of a few probe rays × pixel count.
+double estimateTileCost(const ClusterScene& scene, const TileRect& t) {
+    const int P = 3;
+    double steps = 0.0;
+    for (int j = 0; j < P; ++j)
+        for (int i = 0; i < P; ++i) {
+            int x = t.x0 + (2 * i + 1) * t.w / (2 * P);
+            int y = t.y0 + (2 * j + 1) * t.h / (2 * P);
+            GeodesicRay ray = initGeodesic(scene.view.pos, scene.pixelDir(x, y), scene.tp.rs);
+            steps += traceGeodesic(ray, scene.tp).steps;
+        }
+    return (steps / (P * P) + 1.0) * t.w * t.h;
+}
+
+int runCoordinator(const CliArgs& args, const char* self) {
+    ClusterJob job;
+    job.width = int32_t(args.integer("width", 7680));
+    job.height = int32_t(args.integer("height", 4320));
+    job.mass = args.num("mass", SAGA_MASS);
+    double rs = schwarzschildRadius(job.mass);
+    job.distance = args.num("distance", 6.34194e10 / rs);
+    job.azimuth = args.num("azimuth", 0.0);
+    job.inclination = args.num("inclination", 90.0);
+    job.fov = args.num("fov", 60.0);
+    job.rInRs = args.num("r-in", 2.2);
+    job.rOutRs = args.num("r-out", 5.2);
+    job.tMax = args.num("t-max", 1.5e4);
+    job.exposure = args.num("exposure", 1.5);
+    job.stepScale = args.num("step", 0.02);
+    const int tileSize = int(std::max<long long>(16, args.integer("tile", 256)));
+    const int spawn = int(args.integer("spawn", 0));
+    const int pipeline = int(std::max<long long>(1, args.integer("pipeline", 2)));
+    const double timeout = args.num("timeout", 30.0);
+    const string out = args.str("out", "cluster.ppm");
+
+    Endpoint ep;
+    string listenText = args.str("listen", "unix:/tmp/blackhole-cluster-" + to_string(getpid()) + ".sock");
+    if (!Endpoint::parse(listenText, ep)) {
+        cerr << "Bad --listen endpoint '" << listenText << "'\n";
+        return EXIT_FAILURE;
+    }
+    int listenFd = listenOn(ep);
+    if (listenFd < 0) {
+        cerr << "Cannot listen on " << ep.str() << ": " << strerror(errno) << "\n";
+        return EXIT_FAILURE;
+    }
+
+    auto t0 = Clock::now();
+    ClusterScene scene(job);
+    vector<Tile> tiles;
+    for (int y = 0; y < job.height; y += tileSize)
+        for (int x = 0; x < job.width; x += tileSize) {
+            Tile t;
+            t.rect = { int32_t(tiles.size()), x, y, std::min(tileSize, job.width - x), std::min(tileSize, job.height - y) };
+            tiles.push_back(t);
+        }
+    defaultPool().parallelFor(0, tiles.size(), 1, [&](size_t i0, size_t i1, unsigned) {
+        for (size_t i = i0; i < i1; ++i) tiles[i].cost = estimateTileCost(scene, tiles[i].rect);
+    });
+    auto byCost = [&](int a, int b) { return tiles[a].cost < tiles[b].cost; };
+    priority_queue<int, vector<int>, decltype(byCost)> pending(byCost);
+    for (const Tile& t : tiles) pending.push(t.rect.id);
+    cout << "[INFO] " << tiles.size() << " tiles, cost estimates ready in "
+         << chrono::duration<double>(Clock::now() - t0).count() << " s; listening on " << ep.str() << "\n";
+
+    const int workerThreads = int(args.integer("worker-threads", spawn > 0
+        ? std::max(1u, std::thread::hardware_concurrency() / unsigned(spawn)) : 0));
+    vector<WorkerConn> workers;
+    int respawnsLeft = spawn;
+    for (int i = 0; i < spawn; ++i) {
+        WorkerConn w;
+        w.pid = spawnWorker(self, ep, workerThreads);
+        w.spawned = true;
+        workers.push_back(w);   // fd filled in on accept, matched by the HELLO pid
+    }
+
+    vector<unsigned char> image(size_t(job.width) * job.height * 3, 0);
+    size_t tilesLeft = tiles.size();
+    int dropped = 0;
+    vector<char> payload;
+
+    auto dropWorker = [&](WorkerConn& w, const char* why, bool reaped) {
+        cerr << "[WARN] Worker " << w.pid << " " << why << "; re-queueing " << w.inFlight.size() << " tiles\n";
+        for (int id : w.inFlight) pending.push(id);
+        w.inFlight.clear();
+        if (w.fd >= 0) close(w.fd);
+        w.fd = -1;
+        dropped++;
+        if (w.spawned) {
+            if (!reaped) {
+                kill(w.pid, SIGKILL);
+                waitpid(w.pid, nullptr, 0);
+            }
+            if (respawnsLeft-- > 0 && tilesLeft > 0) {
+                w = WorkerConn();
+                w.pid = spawnWorker(self, ep, workerThreads);
+                w.spawned = true;
+                return;
+            }
+        }
+        w.spawned = false;
+    };
+
+    while (tilesLeft > 0) {
+        // hand out the most expensive pending tiles to free pipeline slots
+        for (WorkerConn& w : workers) {
+            while (w.fd >= 0 && int(w.inFlight.size()) < pipeline && !pending.empty()) {
+                int id = pending.top();
+                pending.pop();
+                if (tiles[id].done) continue;
+                if (!sendMessage(w.fd, MSG_TILE, &tiles[id].rect, sizeof(TileRect))) { pending.push(id); break; }
+                if (w.inFlight.empty()) w.lastHeard = Clock::now();
+                w.inFlight.push_back(id);
+            }
+        }
+
+        vector<pollfd> fds{ { listenFd, POLLIN, 0 } };
+        vector<size_t> owner{ SIZE_MAX };
+        for (size_t i = 0; i < workers.size(); ++i)
+            if (workers[i].fd >= 0) { fds.push_back({ workers[i].fd, POLLIN, 0 }); owner.push_back(i); }
+        if (poll(fds.data(), nfds_t(fds.size()), 250) < 0 && errno != EINTR) break;
+
+        if (fds[0].revents & POLLIN) {
+            // a connection that does not say hello promptly is dropped rather than
+            // left blocking the loop (and everyone else's tiles)
+            int fd = accept(listenFd, nullptr, nullptr);
+            uint32_t type;
+            WorkerHello hello{};
+            if (fd >= 0 && setRecvTimeout(fd, HELLO_TIMEOUT)
+                && recvMessage(fd, type, payload, sizeof(hello)) && type == MSG_HELLO && payload.size() == sizeof(hello)
+                && setRecvTimeout(fd, 0.0) && sendMessage(fd, MSG_JOB, &job, sizeof(job))) {
+                memcpy(&hello, payload.data(), sizeof(hello));
+                WorkerConn* slot = nullptr;
+                for (WorkerConn& w : workers)
+                    if (w.spawned && w.fd < 0 && w.pid == hello.pid) slot = &w;
+                if (!slot) { workers.push_back(WorkerConn()); slot = &workers.back(); slot->pid = hello.pid; }
+                slot->fd = fd;
+                slot->threads = hello.threads;
+                slot->lastHeard = Clock::now();
+                cout << "[INFO] Worker " << hello.pid << " joined with " << hello.threads << " threads\n";
+            } else if (fd >= 0) {
+                close(fd);
+            }
+        }
+
+        for (size_t k = 1; k < fds.size(); ++k) {
+            WorkerConn& w = workers[owner[k]];
+            if (!(fds[k].revents & (POLLIN | POLLHUP | POLLERR))) continue;
+            bool open = w.in.fill(w.fd);
+            uint32_t type;
+            while (w.in.pop(type, payload)) {
+                w.lastHeard = Clock::now();
+                if (type != MSG_RESULT || payload.size() < sizeof(TileRect)) continue;
+                TileRect r;
+                memcpy(&r, payload.data(), sizeof(r));
+                auto it = find(w.inFlight.begin(), w.inFlight.end(), r.id);
+                if (it == w.inFlight.end() || payload.size() != sizeof(TileRect) + size_t(r.w) * r.h * 3) continue;
+                w.inFlight.erase(it);
+                if (tiles[r.id].done) continue;
+                const char* rgb = payload.data() + sizeof(TileRect);
+                for (int y = 0; y < r.h; ++y)
+                    memcpy(&image[(size_t(r.y0 + y) * job.width + r.x0) * 3], rgb + size_t(y) * r.w * 3, size_t(r.w) * 3);
+                tiles[r.id].done = true;
+                w.tilesDone++;
+                tilesLeft--;
+            }
+            if (!open) dropWorker(w, "disconnected", false);
+        }
+
+        auto now = Clock::now();
+        for (WorkerConn& w : workers)
+            if (w.fd >= 0 && !w.inFlight.empty() && chrono::duration<double>(now - w.lastHeard).count() > timeout)
+                dropWorker(w, "timed out", false);
+        // spawned workers that died before connecting
+        for (WorkerConn& w : workers)
+            if (w.spawned && w.fd < 0 && w.pid > 0 && waitpid(w.pid, nullptr, WNOHANG) == w.pid)
+                dropWorker(w, "exited before connecting", true);
+        if (spawn > 0 && none_of(workers.begin(), workers.end(), [](const WorkerConn& w) { return w.fd >= 0 || w.spawned; })) {
+            cerr << "All spawned workers lost and no replacements left\n";
+            break;
+        }
+    }
+
+    for (WorkerConn& w : workers) {
+        if (w.fd >= 0) {
+            sendMessage(w.fd, MSG_BYE, nullptr, 0);
+            close(w.fd);
+        }
+        if (w.spawned && w.pid > 0) waitpid(w.pid, nullptr, 0);
+    }
+    close(listenFd);
+    if (ep.unixSocket) unlink(ep.host.c_str());
+    double secs = chrono::duration<double>(Clock::now() - t0).count();
+
+    if (tilesLeft > 0 || !writePPM(out, job.width, job.height, image.data())) {
+        cerr << "Failed to render or write " << out << "\n";
+        return EXIT_FAILURE;
+    }
+    cout << "[INFO] Rendered " << job.width << "x" << job.height << " in " << secs << " s ("
+         << dropped << " workers dropped), written to " << out << "\n";
+    for (const WorkerConn& w : workers)
+        if (w.tilesDone > 0) cout << "[INFO]   worker " << w.pid << ": " << w.tilesDone << " tiles\n";
+    return 0;
+}
+
+int main(int argc, char** argv) {
+    signal(SIGPIPE, SIG_IGN);
+    CliArgs args(argc, argv);
+    return args.has("worker") ? runWorker(args) : runCoordinator(args, argv[0]);
+}
@@ -0,0 +1,311 @@
+#pragma once
+// Deflection table: every geodesic seen by a static observer at radius r0.
+//
+// By spherical symmetry a ray from the observer is fixed, up to a rotation of
+// its orbital plane, by the angle ψ between its direction and the outward
+// radial. The table traces one ray per ψ (densely around the photon-sphere
+// edge) and stores its orbit r(φ), t(φ) at fixed steps of the orbital-plane
+// angle. Any camera orientation at the same r0 then needs no integration: a
+// pixel's plane gives the φ of its disk crossings and r(φ) is interpolated.
+//
+// Tables depend only on r0 / rs and the escape radius, so animations, tiled
+// renders and parameter sweeps can share them across frames, disk radii and
+// masses (everything is stored in units of rs).
+#include "geodesic_core.h"
+#include "gbuffer.h"
+#include "observer.h"
+#include "parallel.h"
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+struct DeflectionRay {
+    double psi = 0.0;
+    RayTermination termination = RayTermination::MaxSteps;
+    double phiEnd = 0.0;     // orbital angle swept before termination
+    double outAngle = 0.0;   // in-plane angle of the final direction (escaped rays)
+    uint32_t first = 0;      // offset into DeflectionTable::r / t
+    uint32_t count = 0;      // samples at φ = k · dPhi, k < count
+};
+
+struct DeflectionTable {
+    double r0 = 0.0;             // observer radius, units of rs
+    double escapeRadius = 0.0;   // units of rs
+    double dPhi = 0.0;
+    std::vector<DeflectionRay> rays;   // sorted by ψ
+    std::vector<float> r, t;           // orbit samples, units of rs
+
+    static constexpr double MAX_PHI = 6.0 * GEO_PI;   // later windings carry no visible flux
+
+    bool matches(double r0Rs, double escapeRs) const {
+        return !rays.empty() && std::abs(r0 - r0Rs) <= 1e-9 * r0Rs
+            && std::abs(escapeRadius - escapeRs) <= 1e-9 * escapeRs;
+    }
+
+    // ψ grid: uniform plus geometric refinement on both sides of the capture edge.
+    static std::vector<double> psiGrid(double r0, int n) {
+        std::vector<double> psi;
+        for (int i = 0; i <= n; ++i) psi.push_back(GEO_PI * i / n);
+        if (r0 > 1.5) {
+            double sinCrit = 1.5 * std::sqrt(3.0) / r0 * std::sqrt(1.0 - 1.0 / r0);
+            double crit = GEO_PI - std::asin(std::min(sinCrit, 1.0));
+            for (double d = 0.05; d > 1e-9; d *= 0.7) {
+                if (crit - d > 0.0) psi.push_back(crit - d);
+                if (crit + d < GEO_PI) psi.push_back(crit + d);
+            }
+        }
+        std::sort(psi.begin(), psi.end());
+        psi.erase(std::unique(psi.begin(), psi.end()), psi.end());
+        return psi;
+    }
+
+    // Traces in units of rs = 1; r0Rs and escapeRs are in Schwarzschild radii.
+    static DeflectionTable build(double r0Rs, double escapeRs, int nPsi = 2048,
+                                 int phiSteps = 2048, ThreadPool& pool = defaultPool()) {
+        DeflectionTable tab;
+        tab.r0 = r0Rs;
+        tab.escapeRadius = escapeRs;
+        tab.dPhi = 2.0 * GEO_PI / phiSteps;
+        std::vector<double> psi = psiGrid(r0Rs, nPsi);
+        tab.rays.resize(psi.size());
+        std::vector<std::vector<float>> rs(psi.size()), ts(psi.size());
+
+        TraceParams tp;
+        tp.rs = 1.0;
+        tp.escapeRadius = escapeRs;
+        tp.maxSteps = 200000;
+        pool.parallelFor(0, psi.size(), 16, [&](size_t i0, size_t i1, unsigned) {
+            for (size_t i = i0; i < i1; ++i) {
+                glm::dvec3 dir(std::cos(psi[i]), std::sin(psi[i]), 0.0);
+                GeodesicRay ray = initGeodesic(glm::dvec3(r0Rs, 0.0, 0.0), dir, 1.0);
+                std::vector<float>& rOut = rs[i];
+                std::vector<float>& tOut = ts[i];
+                rOut.push_back(float(r0Rs));
+                tOut.push_back(0.0f);
+                GeodesicState prev = ray.s;
+                GeodesicResult res = traceGeodesic(ray, tp, [&](const GeodesicRay& g) {
+                    for (double phi = rOut.size() * tab.dPhi; phi <= g.s.phi; phi = rOut.size() * tab.dPhi) {
+                        double w = (phi - prev.phi) / (g.s.phi - prev.phi);
+                        rOut.push_back(float(prev.r + w * (g.s.r - prev.r)));
+                        tOut.push_back(float(prev.t + w * (g.s.t - prev.t)));
+                    }
+                    prev = g.s;
+                    return g.s.phi < MAX_PHI;
+                });
+                DeflectionRay& d = tab.rays[i];
+                d.psi = psi[i];
+                d.termination = res.termination;
+                d.phiEnd = ray.s.phi;
+                d.outAngle = ray.s.phi + std::atan2(ray.L / ray.s.r, ray.s.dr);
+            }
+        });
+        for (size_t i = 0; i < psi.size(); ++i) {
+            tab.rays[i].first = uint32_t(tab.r.size());
+            tab.rays[i].count = uint32_t(rs[i].size());
+            tab.r.insert(tab.r.end(), rs[i].begin(), rs[i].end());
+            tab.t.insert(tab.t.end(), ts[i].begin(), ts[i].end());
+        }
+        return tab;
+    }
+
+    // r and t of ray i at orbital angle phi; false past the end of its orbit.
+    bool orbitAt(size_t i, double phi, double& rOut, double& tOut) const {
+        const DeflectionRay& d = rays[i];
+        double f = phi / dPhi;
+        size_t k = size_t(f);
+        if (phi > d.phiEnd || k + 1 >= d.count) return false;
+        double w = f - double(k);
+        rOut = (1.0 - w) * r[d.first + k] + w * r[d.first + k + 1];
+        tOut = (1.0 - w) * t[d.first + k] + w * t[d.first + k + 1];
+        return true;
+    }
+
+    // G-buffer sample for direction dir seen from pos (|pos| = r0 · rs).
+    GSample sample(const glm::dvec3& pos, const glm::dvec3& dir, double rs,
+                   double diskInner, double diskOuter) const {
+        return lookup(pos, dir, rs, diskOuter > diskInner, [&](double r, double, double, double) {
+            return r * rs >= diskInner && r * rs <= diskOuter;
+        });
+    }
+
+    // The ray for direction dir seen from pos by table lookup. With crossings,
+    // stop(r, azimuth, g, t) is called for its disk-plane crossings in order
+    // along the orbit (r and t in units of rs); the first one it accepts is
+    // returned as a Disk sample. Otherwise the sample is where the ray ends.
+    template <class Stop>
+    GSample lookup(const glm::dvec3& pos, const glm::dvec3& dirIn, double rs, bool crossings,
+                   Stop&& stop) const {
+        glm::dvec3 dir = glm::normalize(dirIn);
+        glm::dvec3 e1 = glm::normalize(pos);
+        double c = std::clamp(glm::dot(dir, e1), -1.0, 1.0);
+        double psi = std::acos(c);
+        glm::dvec3 perp = dir - c * e1;
+        if (glm::length(perp) < 1e-12) {
+            glm::dvec3 helper = std::abs(e1.y) < 0.9 ? glm::dvec3(0, 1, 0) : glm::dvec3(1, 0, 0);
+            perp = glm::cross(e1, helper);
+        }
+        glm::dvec3 e2 = glm::normalize(perp);
+
+        auto it = std::upper_bound(rays.begin(), rays.end(), psi,
+                                   [](double p, const DeflectionRay& d) { return p < d.psi; });
+        size_t hi = std::min(size_t(it - rays.begin()), rays.size() - 1);
+        size_t lo = hi > 0 ? hi - 1 : 0;
+        double span = rays[hi].psi - rays[lo].psi;
+        double w = span > 0.0 ? std::clamp((psi - rays[lo].psi) / span, 0.0, 1.0) : 0.0;
+        size_t nearest = w < 0.5 ? lo : hi;
+        bool blend = rays[lo].termination == rays[hi].termination;
+
+        GSample s;
+        // disk crossings in order along the orbit
+        if (crossings) {
+            GeodesicRay g{};
+            g.e1 = e1; g.e2 = e2; g.normal = glm::cross(e1, e2);
+            g.rs = 1.0;
+            g.E = std::sqrt(1.0 - 1.0 / r0);
+            g.L = r0 * std::sin(psi);
+            double phiEnd = blend ? std::min(rays[lo].phiEnd, rays[hi].phiEnd) : rays[nearest].phiEnd;
+            for (double phi = nextPlaneCrossing(g, 0.0); phi < phiEnd; phi += GEO_PI) {
+                double rA, tA, rB, tB, rc, tc;
+                if (blend) {
+                    if (!orbitAt(lo, phi, rA, tA) || !orbitAt(hi, phi, rB, tB)) break;
+                    rc = (1.0 - w) * rA + w * rB;
+                    tc = (1.0 - w) * tA + w * tB;
+                } else if (!orbitAt(nearest, phi, rc, tc)) {
+                    break;
+                }
+                glm::dvec3 x = rc * (std::cos(phi) * e1 + std::sin(phi) * e2);
+                double azimuth = std::atan2(x.x, x.z);
+                double redshift = keplerianRedshift(g, rc);
+                if (!stop(rc, azimuth, redshift, tc)) continue;
+                s.kind = GSampleKind::Disk;
+                s.r = float(rc * rs);
+                s.azimuth = float(azimuth);
+                s.g = float(redshift);
+                s.delay = float(tc * rs);
+                return s;
+            }
+        }
+        RayTermination term = rays[nearest].termination;
+        if (term != RayTermination::Escaped) {   // captured, or still winding at MAX_PHI
+            s.kind = GSampleKind::Hole;
+            return s;
+        }
+        double a = blend ? (1.0 - w) * rays[lo].outAngle + w * rays[hi].outAngle : rays[nearest].outAngle;
+        glm::dvec3 out = std::cos(a) * e1 + std::sin(a) * e2;
+        s.kind = GSampleKind::Sky;
+        s.dir[0] = float(out.x);
+        s.dir[1] = float(out.y);
+        s.dir[2] = float(out.z);
+        return s;
+    }
+
+    // Fills rows [y0, y1) of a W×H view by table lookup, like traceGBufferRows.
+    void sampleRows(const ObserverView& view, int W, int H, int y0, int y1, double rs,
+                    double diskInner, double diskOuter, std::vector<GSample>& out) const {
+        for (int y = y0; y < y1; ++y)
+            for (int x = 0; x < W; ++x)
+                out[size_t(y) * W + x] = sample(view.pos, view.pixelDir(x, double(y), W, H),
+                                                rs, diskInner, diskOuter);
+    }
+
+    // -- file cache -- //
+    bool save(const std::string& path) const {
+        FILE* f = std::fopen(path.c_str(), "wb");
+        if (!f) return false;
+        const char magic[8] = { 'B','H','D','E','F','L','0','1' };
+        const double params[3] = { r0, escapeRadius, dPhi };
+        const uint64_t sizes[2] = { rays.size(), r.size() };
+        std::fwrite(magic, 1, 8, f);
+        std::fwrite(params, sizeof(double), 3, f);
+        std::fwrite(sizes, sizeof(uint64_t), 2, f);
+        std::fwrite(rays.data(), sizeof(DeflectionRay), rays.size(), f);
+        std::fwrite(r.data(), sizeof(float), r.size(), f);
+        std::fwrite(t.data(), sizeof(float), t.size(), f);
+        return std::fclose(f) == 0;
+    }
+
+    bool load(const std::string& path) {
+        FILE* f = std::fopen(path.c_str(), "rb");
+        if (!f) return false;
+        char magic[8];
+        double params[3];
+        uint64_t sizes[2];
+        bool ok = std::fread(magic, 1, 8, f) == 8 && std::string(magic, 8) == "BHDEFL01"
+               && std::fread(params, sizeof(double), 3, f) == 3
+               && std::fread(sizes, sizeof(uint64_t), 2, f) == 2;
+        if (ok) {
+            r0 = params[0]; escapeRadius = params[1]; dPhi = params[2];
+            rays.resize(sizes[0]);
+            r.resize(sizes[1]);
+            t.resize(sizes[1]);
+            ok = std::fread(rays.data(), sizeof(DeflectionRay), rays.size(), f) == rays.size()
+              && std::fread(r.data(), sizeof(float), r.size(), f) == r.size()
+              && std::fread(t.data(), sizeof(float), t.size(), f) == t.size();
+        }
+        std::fclose(f);
+        return ok;
+    }
+};
+
+// Every disk-plane crossing of every pixel of one view, from a deflection
+// table and in units of rs. The G-buffer for any disk annulus and any mass is
+// then the first crossing inside the annulus, scaled by rs, or where the ray
+// ends when none is, so views swept over disk radii and masses share one.
+struct ViewCrossings {
+    struct Crossing { float r, azimuth, g, t; };   // r and t in units of rs
+
+    int width = 0, height = 0;
+    std::vector<uint32_t> first;       // width · height + 1 offsets into crossings
+    std::vector<Crossing> crossings;   // in order along each ray
+    std::vector<GSample> end;          // where each ray ends, Sky or Hole
+
+    static ViewCrossings build(const DeflectionTable& table, const ObserverView& view, int W, int H,
+                               ThreadPool& pool = defaultPool()) {
+        ViewCrossings vc;
+        vc.width = W; vc.height = H;
+        vc.end.resize(size_t(W) * H);
+        std::vector<std::vector<Crossing>> rows(H);
+        std::vector<uint8_t> count(size_t(W) * H, 0);
+        const glm::dvec3 pos = glm::normalize(view.pos) * table.r0;
+        pool.parallelFor(0, size_t(H), 1, [&](size_t y0, size_t y1, unsigned) {
+            for (size_t y = y0; y < y1; ++y)
+                for (int x = 0; x < W; ++x) {
+                    size_t i = y * W + x;
+                    vc.end[i] = table.lookup(pos, view.pixelDir(x, double(y), W, H), 1.0, true,
+                                             [&](double r, double azimuth, double g, double t) {
+                        rows[y].push_back({ float(r), float(azimuth), float(g), float(t) });
+                        count[i]++;
+                        return false;
+                    });
+                }
+        });
+        vc.first.resize(count.size() + 1);
+        vc.first[0] = 0;
+        for (size_t i = 0; i < count.size(); ++i) vc.first[i + 1] = vc.first[i] + count[i];
+        vc.crossings.reserve(vc.first.back());
+        for (auto& row : rows) vc.crossings.insert(vc.crossings.end(), row.begin(), row.end());
+        return vc;
+    }
+
+    // Pixel i for the disk [rIn, rOut] (units of rs) around a hole of radius rs.
+    GSample sample(size_t i, double rs, double rIn, double rOut) const {
+        for (uint32_t k = first[i]; k < first[i + 1]; ++k) {
+            const Crossing& c = crossings[k];
+            if (c.r < rIn || c.r > rOut) continue;
+            GSample s;
+            s.kind = GSampleKind::Disk;
+            s.r = float(c.r * rs);
+            s.azimuth = c.azimuth;
+            s.g = c.g;
+            s.delay = float(c.t * rs);
+            return s;
+        }
+        return end[i];
+    }
+
+    size_t bytes() const {
+        return first.size() * sizeof(uint32_t) + crossings.size() * sizeof(Crossing) + end.size() * sizeof(GSample);
+    }
+};
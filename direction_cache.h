@@ -0,0 +1,202 @@
+#pragma once
+// Direction-sphere cache: the G-buffer of every direction on one observer's sky.
+//
+// For a fixed observer position, a pixel's geodesic depends only on its
+// direction. DirectionCubemap samples the whole sky once on a cubemap; any
+// view from that position — rotated (ObserverView::rotated), zoomed by fov,
+// or seen by a moving observer (aberrate) — is then a lookup per pixel with
+// no integration.
+//
+// Sampling is adaptive: the sky is traced at faceSize² texels per face, and
+// every BLOCK × BLOCK block where neighbouring samples change kind (disk
+// edge, shadow edge, disk images) or vary quickly is traced again `refine`
+// times finer. Lookups interpolate bilinearly between samples of one kind
+// and take the nearest sample across a kind boundary; face seams are clamped.
+#include "gbuffer.h"
+#include "parallel.h"
+#include <glm/glm.hpp>
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <vector>
+
+struct DirectionCubemap {
+    static constexpr int BLOCK = 8;   // coarse texels per block edge
+
+    // When neighbouring samples of one kind differ by more than this, their block is refined.
+    struct Refinement {
+        double diskRadius = 0.02;    // relative change of the landing radius
+        double diskG = 0.02;         // change of g
+        double skyAngle = 0.02;      // radians between asymptotic directions
+    };
+
+    glm::dvec3 pos{0.0};
+    int faceSize = 0;                 // coarse texels per face edge
+    int refine = 1;                   // fine texels per coarse texel in refined blocks
+    std::vector<GSample> coarse;      // [face][y][x]
+    std::vector<int32_t> blockFine;   // [face][by][bx] → first fine sample, or -1
+    std::vector<GSample> fine;        // refined blocks, (BLOCK · refine)² samples each
+
+    int blocksPerEdge() const { return (faceSize + BLOCK - 1) / BLOCK; }
+    size_t bytes() const {
+        return (coarse.size() + fine.size()) * sizeof(GSample) + blockFine.size() * sizeof(int32_t);
+    }
+    double refinedFraction() const {
+        size_t n = 0;
+        for (int32_t b : blockFine) n += b >= 0;
+        return blockFine.empty() ? 0.0 : double(n) / blockFine.size();
+    }
+
+    // Unit direction through face coordinates (u, v) in [-1, 1].
+    static glm::dvec3 faceDir(int face, double u, double v) {
+        int axis = face / 2;
+        glm::dvec3 d(0.0);
+        d[axis] = face % 2 ? -1.0 : 1.0;
+        d[(axis + 1) % 3] = u;
+        d[(axis + 2) % 3] = v;
+        return glm::normalize(d);
+    }
+    static int dirFace(const glm::dvec3& d, double& u, double& v) {
+        double ax = std::abs(d.x), ay = std::abs(d.y), az = std::abs(d.z);
+        int axis = ax >= ay && ax >= az ? 0 : (ay >= az ? 1 : 2);
+        double m = std::max(ax, std::max(ay, az));
+        u = d[(axis + 1) % 3] / m;
+        v = d[(axis + 2) % 3] / m;
+        return 2 * axis + (d[axis] < 0.0 ? 1 : 0);
+    }
+
+    // sample(dir) returns the GSample seen from pos along dir; it is called
+    // concurrently from the pool.
+    template <class Sampler>
+    static DirectionCubemap build(const glm::dvec3& pos, int faceSize, int refine, Sampler&& sample,
+                                  const Refinement& crit = Refinement(), ThreadPool& pool = defaultPool()) {
+        DirectionCubemap m;
+        m.pos = pos;
+        m.faceSize = faceSize;
+        m.refine = std::max(1, refine);
+        const int N = faceSize, NB = m.blocksPerEdge();
+        m.coarse.resize(size_t(6) * N * N);
+        pool.parallelFor(0, size_t(6) * N, 4, [&](size_t r0, size_t r1, unsigned) {
+            for (size_t row = r0; row < r1; ++row) {
+                int face = int(row / N), y = int(row % N);
+                for (int x = 0; x < N; ++x)
+                    m.coarse[row * N + x] = sample(faceDir(face, 2.0 * (x + 0.5) / N - 1.0, 2.0 * (y + 0.5) / N - 1.0));
+            }
+        });
+
+        // flag blocks whose samples (with a one-texel border) vary too much
+        m.blockFine.assign(size_t(6) * NB * NB, -1);
+        if (m.refine == 1) return m;
+        std::vector<uint8_t> flagged(m.blockFine.size(), 0);
+        pool.parallelFor(0, flagged.size(), 16, [&](size_t b0, size_t b1, unsigned) {
+            for (size_t b = b0; b < b1; ++b) {
+                int face = int(b / (NB * NB)), by = int(b / NB % NB), bx = int(b % NB);
+                int x0 = std::max(0, bx * BLOCK - 1), x1 = std::min(N - 1, bx * BLOCK + BLOCK);
+                int y0 = std::max(0, by * BLOCK - 1), y1 = std::min(N - 1, by * BLOCK + BLOCK);
+                bool rough = false;
+                for (int y = y0; y <= y1 && !rough; ++y)
+                    for (int x = x0; x <= x1 && !rough; ++x) {
+                        const GSample& s = m.coarse[(size_t(face) * N + y) * N + x];
+                        if (x < x1) rough = differ(s, m.coarse[(size_t(face) * N + y) * N + x + 1], crit);
+                        if (!rough && y < y1) rough = differ(s, m.coarse[(size_t(face) * N + y + 1) * N + x], crit);
+                    }
+                flagged[b] = rough;
+            }
+        });
+        const int F = BLOCK * m.refine;
+        std::vector<size_t> refined;
+        for (size_t b = 0; b < flagged.size(); ++b)
+            if (flagged[b]) {
+                m.blockFine[b] = int32_t(refined.size() * F * F);
+                refined.push_back(b);
+            }
+        m.fine.resize(refined.size() * F * F);
+        const int NF = N * m.refine;
+        pool.parallelFor(0, refined.size() * F, 8, [&](size_t r0, size_t r1, unsigned) {
+            for (size_t row = r0; row < r1; ++row) {
+                size_t b = refined[row / F];
+                int face = int(b / (NB * NB)), by = int(b / NB % NB), bx = int(b % NB);
+                int y = by * F + int(row % F);
+                GSample* out = &m.fine[size_t(m.blockFine[b]) + (row % F) * F];
+                for (int i = 0; i < F; ++i) {
+                    int x = bx * F + i;
+                    if (x >= NF || y >= NF) continue;   // partial block at the face edge
+                    out[i] = sample(faceDir(face, 2.0 * (x + 0.5) / NF - 1.0, 2.0 * (y + 0.5) / NF - 1.0));
+                }
+            }
+        });
+        return m;
+    }
+
+    // G-buffer sample for a unit direction from pos.
+    GSample lookup(const glm::dvec3& dir) const {
+        double u, v;
+        int face = dirFace(dir, u, v);
+        double cx = (u + 1.0) * 0.5 * faceSize, cy = (v + 1.0) * 0.5 * faceSize;
+        int bx = std::clamp(int(cx), 0, faceSize - 1) / BLOCK, by = std::clamp(int(cy), 0, faceSize - 1) / BLOCK;
+        bool isFine = blockFine[(size_t(face) * blocksPerEdge() + by) * blocksPerEdge() + bx] >= 0;
+        int res = isFine ? faceSize * refine : faceSize;
+        double fx = (u + 1.0) * 0.5 * res - 0.5, fy = (v + 1.0) * 0.5 * res - 0.5;
+        int x0 = int(std::floor(fx)), y0 = int(std::floor(fy));
+        double wx = fx - x0, wy = fy - y0;
+
+        const GSample* s[4] = { &texel(face, x0, y0, res), &texel(face, x0 + 1, y0, res),
+                                &texel(face, x0, y0 + 1, res), &texel(face, x0 + 1, y0 + 1, res) };
+        const double w[4] = { (1 - wx) * (1 - wy), wx * (1 - wy), (1 - wx) * wy, wx * wy };
+        bool same = s[1]->kind == s[0]->kind && s[2]->kind == s[0]->kind && s[3]->kind == s[0]->kind;
+        if (!same || s[0]->kind == GSampleKind::Hole)
+            return *s[std::max_element(w, w + 4) - w];
+
+        GSample out = *s[0];
+        if (out.kind == GSampleKind::Disk) {
+            double r = 0, g = 0, delay = 0, az = 0;
+            for (int i = 0; i < 4; ++i) {
+                double da = s[i]->azimuth - s[0]->azimuth;   // unwrap around ±π
+                da -= 2.0 * GEO_PI * std::round(da / (2.0 * GEO_PI));
+                r += w[i] * s[i]->r;
+                g += w[i] * s[i]->g;
+                delay += w[i] * s[i]->delay;
+                az += w[i] * da;
+            }
+            az += s[0]->azimuth;
+            out.r = float(r);
+            out.g = float(g);
+            out.delay = float(delay);
+            out.azimuth = float(az - 2.0 * GEO_PI * std::round(az / (2.0 * GEO_PI)));
+        }
+        glm::dvec3 d(0.0);
+        for (int i = 0; i < 4; ++i) d += w[i] * glm::dvec3(s[i]->dir[0], s[i]->dir[1], s[i]->dir[2]);
+        if (glm::length(d) > 0.0) d = glm::normalize(d);
+        out.dir[0] = float(d.x);
+        out.dir[1] = float(d.y);
+        out.dir[2] = float(d.z);
+        return out;
+    }
+
+private:
+    // Sample (x, y) of a face at resolution res (faceSize or faceSize · refine), clamped to the face.
+    const GSample& texel(int face, int x, int y, int res) const {
+        x = std::clamp(x, 0, res - 1);
+        y = std::clamp(y, 0, res - 1);
+        if (res != faceSize) {
+            const int F = BLOCK * refine;
+            int32_t first = blockFine[(size_t(face) * blocksPerEdge() + y / F) * blocksPerEdge() + x / F];
+            if (first >= 0) return fine[size_t(first) + size_t(y % F) * F + x % F];
+            x /= refine;
+            y /= refine;
+        }
+        return coarse[(size_t(face) * faceSize + y) * faceSize + x];
+    }
+
+    static bool differ(const GSample& a, const GSample& b, const Refinement& crit) {
+        if (a.kind != b.kind) return true;
+        if (a.kind == GSampleKind::Disk)
+            return std::abs(a.r - b.r) > crit.diskRadius * std::max(a.r, b.r)
+                || std::abs(a.g - b.g) > crit.diskG;
+        if (a.kind == GSampleKind::Sky) {
+            double c = a.dir[0] * b.dir[0] + a.dir[1] * b.dir[1] + a.dir[2] * b.dir[2];
+            return c < std::cos(crit.skyAngle);
+        }
+        return false;
+    }
+};
@@ -0,0 +1,183 @@
+#pragma once
+// Disk self-irradiation: light from one annulus bent back onto another.
+//
+// Precompute: from each of BINS annuli, rays are launched over the upper
+// hemisphere (cosine-weighted in the orbiting gas frame, then aberrated to the
+// static frame) and followed to their first landing on the disk. The result is
+// a sparse radius-to-radius matrix M, stored CSR by receiving bin, with
+//
+//   F_irr[j] = Σ_i M[j][i] · F[i]
+//
+// in the same units as EmissionTables::flux (F / F_max), so a frame only needs
+// a sparse mat-vec per bounce. Each ray carries g² of its emitter's energy
+// (photon energy × arrival rate) for ν_rec / ν_em between the two orbits.
+#include "geodesic_core.h"
+#include "emission_tables.h"
+#include "frame_arena.h"
+#include "parallel.h"
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+struct DiskIrradiation {
+    static constexpr int BINS = 64;
+
+    float rIn = 0.0f, rOut = 0.0f, rs = 0.0f;   // annulus and hole, meters
+    int directions = 0;                         // rays per emitting bin
+    std::vector<uint32_t> rowStart;             // BINS + 1
+    std::vector<uint32_t> col;                  // emitting bin
+    std::vector<float> value;                   // M[j][i]
+
+    double binRadius(int i) const { return rIn + (rOut - rIn) * (i + 0.5) / BINS; }
+    double binArea(int i) const {
+        double a = rIn + (rOut - rIn) * double(i) / BINS, b = rIn + (rOut - rIn) * double(i + 1) / BINS;
+        return GEO_PI * (b * b - a * a);
+    }
+    int binOf(double r) const {
+        int i = int((r - rIn) / (rOut - rIn) * BINS);
+        return std::clamp(i, 0, BINS - 1);
+    }
+
+    // Frequency seen by a prograde Keplerian orbit at r, relative to the static
+    // observer at the launch point (initGeodesic normalises that to 1).
+    static double orbitFrequency(const GeodesicRay& ray, double r) {
+        double omega = std::sqrt(ray.rs / (2.0 * r * r * r));
+        return (ray.E - omega * ray.L * ray.normal.y) / std::sqrt(1.0 - 1.5 * ray.rs / r);
+    }
+
+    // -- precompute -- //
+    static DiskIrradiation build(double rIn, double rOut, double rs, int directions = 2048,
+                                 ThreadPool& pool = defaultPool()) {
+        DiskIrradiation m;
+        m.rIn = float(rIn); m.rOut = float(rOut); m.rs = float(rs);
+        const int side = std::max(1, int(std::sqrt(double(directions))));
+        m.directions = side * side;
+
+        TraceParams tp;
+        tp.rs = rs;
+        tp.escapeRadius = 2.0 * rOut;
+        tp.diskInner = rIn;
+        tp.diskOuter = rOut;
+        tp.stopAtDisk = true;
+
+        // dense column per emitting bin, owned by the task that traces it
+        std::vector<double> dense(size_t(BINS) * BINS, 0.0);   // [i * BINS + j]
+        pool.parallelFor(0, BINS, 1, [&](size_t i0, size_t i1, unsigned) {
+            for (size_t i = i0; i < i1; ++i) {
+                double* column = &dense[i * BINS];
+                for (int a = 0; a < side; ++a)
+                    for (int b = 0; b < side; ++b) {
+                        // stratified radius within the bin and cosine-weighted direction
+                        double u = (a + 0.5) / side, v = (b + 0.5) / side;
+                        double r = rIn + (rOut - rIn) * (double(i) + v) / BINS;
+                        if (r <= 1.5 * rs) continue;
+                        double sinT = std::sqrt(u), cosT = std::sqrt(1.0 - u);
+                        double ph = 2.0 * GEO_PI * (b + 0.5 * (a & 1)) / side;
+                        // gas frame at azimuth 0: +x along the orbit, +y the disk normal, +z outward
+                        glm::dvec3 d(sinT * std::cos(ph), cosT, sinT * std::sin(ph));
+                        double beta = std::sqrt(0.5 * rs / (r - rs));
+                        double gamma = 1.0 / std::sqrt(1.0 - beta * beta);
+                        double k = 1.0 + beta * d.x;
+                        glm::dvec3 dStatic((d.x + beta) / k, d.y / (gamma * k), d.z / (gamma * k));
+
+                        GeodesicRay ray = initGeodesic(glm::dvec3(0.0, 1e-7 * r, r), dStatic, rs);
+                        double nuEm = orbitFrequency(ray, r);
+                        GeodesicResult res = traceGeodesic(ray, tp);
+                        if (res.termination != RayTermination::Disk || nuEm <= 0.0) continue;
+                        double g = orbitFrequency(ray, res.firstDisk.r) / nuEm;
+                        if (g > 0.0) column[m.binOf(res.firstDisk.r)] += g * g;
+                    }
+            }
+        });
+
+        // M[j][i] = area_i / (N · area_j) · Σ g²
+        m.rowStart.assign(BINS + 1, 0);
+        for (int j = 0; j < BINS; ++j) {
+            for (int i = 0; i < BINS; ++i) {
+                double s = dense[size_t(i) * BINS + j];
+                if (s <= 0.0) continue;
+                m.col.push_back(uint32_t(i));
+                m.value.push_back(float(s * m.binArea(i) / (double(m.directions) * m.binArea(j))));
+            }
+            m.rowStart[j + 1] = uint32_t(m.col.size());
+        }
+        return m;
+    }
+
+    // -- per frame -- //
+    // y = M · x, both BINS long.
+    void multiply(const float* x, float* y) const {
+        for (int j = 0; j < BINS; ++j) {
+            float sum = 0.0f;
+            for (uint32_t k = rowStart[j]; k < rowStart[j + 1]; ++k) sum += value[k] * x[col[k]];
+            y[j] = sum;
+        }
+    }
+
+    // Intrinsic flux of each bin from the emission tables (zero inside the ISCO).
+    void binFlux(const EmissionTables& tables, float* F) const {
+        for (int i = 0; i < BINS; ++i) F[i] = float(tables.fluxAt(binRadius(i)));
+    }
+
+    // Irradiating flux per bin for intrinsic flux F (per bin), with `bounces`
+    // rounds of reprocessing; efficiency is the absorbed (thermalised) fraction.
+    // Called every frame, so its scratch comes from the frame arena.
+    void illuminate(const float* F, int bounces, float efficiency, std::vector<float>& irradiation) const {
+        FrameArena::Scope scratch(threadFrameArena());
+        FrameVector<float> total(F, F + BINS), received(BINS);
+        irradiation.assign(BINS, 0.0f);
+        for (int b = 0; b < bounces; ++b) {
+            multiply(total.data(), received.data());
+            for (int j = 0; j < BINS; ++j) {
+                irradiation[j] = efficiency * received[j];
+                total[j] = F[j] + irradiation[j];
+            }
+        }
+    }
+
+    bool matches(double rIn_, double rOut_, double rs_) const {
+        auto close = [](double a, double b) { return std::abs(a - b) <= 1e-6 * std::abs(b); };
+        return rowStart.size() == size_t(BINS + 1) && close(rIn, rIn_) && close(rOut, rOut_) && close(rs, rs_);
+    }
+
+    // -- file cache -- //
+    bool save(const std::string& path) const {
+        FILE* f = std::fopen(path.c_str(), "wb");
+        if (!f) return false;
+        const char magic[8] = { 'B','H','I','R','R','0','0','1' };
+        const int32_t header[3] = { BINS, directions, int32_t(col.size()) };
+        const float params[3] = { rIn, rOut, rs };
+        std::fwrite(magic, 1, 8, f);
+        std::fwrite(header, sizeof(int32_t), 3, f);
+        std::fwrite(params, sizeof(float), 3, f);
+        std::fwrite(rowStart.data(), sizeof(uint32_t), rowStart.size(), f);
+        std::fwrite(col.data(), sizeof(uint32_t), col.size(), f);
+        std::fwrite(value.data(), sizeof(float), value.size(), f);
+        return std::fclose(f) == 0;
+    }
+
+    bool load(const std::string& path) {
+        FILE* f = std::fopen(path.c_str(), "rb");
+        if (!f) return false;
+        char magic[8];
+        int32_t header[3];
+        float params[3];
+        bool ok = std::fread(magic, 1, 8, f) == 8 && std::string(magic, 8) == "BHIRR001"
+               && std::fread(header, sizeof(int32_t), 3, f) == 3 && header[0] == BINS && header[2] >= 0
+               && std::fread(params, sizeof(float), 3, f) == 3;
+        if (ok) {
+            directions = header[1];
+            rIn = params[0]; rOut = params[1]; rs = params[2];
+            rowStart.resize(BINS + 1);
+            col.resize(size_t(header[2]));
+            value.resize(size_t(header[2]));
+            ok = std::fread(rowStart.data(), sizeof(uint32_t), rowStart.size(), f) == rowStart.size()
+              && std::fread(col.data(), sizeof(uint32_t), col.size(), f) == col.size()
+              && std::fread(value.data(), sizeof(float), value.size(), f) == value.size()
+              && rowStart.back() == col.size();
+        }
+        std::fclose(f);
+        return ok;
+    }
+};
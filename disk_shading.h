@@ -0,0 +1,33 @@
+#pragma once
+// CPU shading of G-buffer samples with the same emission tables geodesic.comp samples.
+#include "gbuffer.h"
+#include "emission_tables.h"
+#include <glm/glm.hpp>
+#include <cstddef>
+
+struct ShadeParams {
+    double exposure = 1.5;
+    glm::vec3 sky = glm::vec3(0.01f, 0.01f, 0.03f);   // deep space blue, as in geodesic.comp
+};
+
+inline glm::vec3 shadeSample(const GSample& s, const EmissionTables& tables, const ShadeParams& p) {
+    switch (s.kind) {
+        case GSampleKind::Disk: return tables.shadeDisk(s.r, s.g, p.exposure);
+        case GSampleKind::Hole: return glm::vec3(0.0f);
+        default:                return p.sky;
+    }
+}
+
+inline void storeRGB8(const glm::vec3& c, unsigned char* out) {
+    glm::vec3 v = glm::clamp(c, 0.0f, 1.0f);
+    out[0] = (unsigned char)(v.r * 255.0f + 0.5f);
+    out[1] = (unsigned char)(v.g * 255.0f + 0.5f);
+    out[2] = (unsigned char)(v.b * 255.0f + 0.5f);
+}
+
+// Shades samples [begin, end) into 8-bit RGB at rgb[3 * i].
+inline void shadeRGB8(const GSample* samples, size_t begin, size_t end, const EmissionTables& tables,
+                      const ShadeParams& p, unsigned char* rgb) {
+    for (size_t i = begin; i < end; ++i)
+        storeRGB8(shadeSample(samples[i], tables, p), rgb + 3 * i);
+}
@@ -0,0 +1,130 @@
+#pragma once
+// Disk transfer function: for every pixel whose geodesic lands on the disk,
+// where it lands (radius, azimuth), the frequency ratio g, the coordinate
+// time delay and the pixel's solid angle. Traced once, then reused by table
+// lookups; it can be cached on disk between runs.
+#include "geodesic_core.h"
+#include "observer.h"
+#include "parallel.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+struct TransferSample {
+    float r;         // landing radius, meters
+    float azimuth;   // disk azimuth, see DiskCrossing
+    float g;         // ν_obs / ν_em
+    float delay;     // c·t from emission to the observer, meters
+    float dOmega;    // pixel solid angle, sr
+    float u, v;      // tangent-plane image coordinates
+    uint32_t pixel;  // y * width + x
+};
+
+struct DiskTransfer {
+    int width = 0, height = 0;
+    double rs = 0.0;
+    // what the table was traced for, checked before reusing a cached file
+    double distance = 0.0, inclination = 0.0, tanHalfFov = 0.0;
+    double diskInner = 0.0, diskOuter = 0.0;
+    std::vector<TransferSample> samples;   // sorted by r
+
+    bool matches(const ObserverView& view, int W, int H, const TraceParams& tp) const {
+        auto same = [](double a, double b) { return std::abs(a - b) <= 1e-9 * std::max(std::abs(a), std::abs(b)); };
+        return width == W && height == H && same(rs, tp.rs)
+            && same(distance, glm::length(view.pos))
+            && same(inclination, std::acos(view.pos.y / glm::length(view.pos)))
+            && same(tanHalfFov, view.tanHalfFov)
+            && same(diskInner, tp.diskInner) && same(diskOuter, tp.diskOuter);
+    }
+
+    // Samples with r in [r0, r1] as a [first, last) index range.
+    std::pair<size_t, size_t> radialRange(double r0, double r1) const {
+        auto lo = std::lower_bound(samples.begin(), samples.end(), r0,
+                                   [](const TransferSample& s, double r) { return s.r < r; });
+        auto hi = std::upper_bound(lo, samples.end(), r1,
+                                   [](double r, const TransferSample& s) { return r < s.r; });
+        return { size_t(lo - samples.begin()), size_t(hi - samples.begin()) };
+    }
+
+    static DiskTransfer trace(const ObserverView& view, int W, int H, const TraceParams& tp,
+                              ThreadPool& pool = defaultPool()) {
+        DiskTransfer dt;
+        dt.width = W; dt.height = H; dt.rs = tp.rs;
+        dt.distance = glm::length(view.pos);
+        dt.inclination = std::acos(view.pos.y / dt.distance);
+        dt.tanHalfFov = view.tanHalfFov;
+        dt.diskInner = tp.diskInner;
+        dt.diskOuter = tp.diskOuter;
+        TraceParams p = tp;
+        p.stopAtDisk = true;
+
+        std::vector<std::vector<TransferSample>> local(pool.size());
+        const double du = 2.0 * view.aspect * view.tanHalfFov / W;
+        const double dv = 2.0 * view.tanHalfFov / H;
+        pool.parallelFor(0, size_t(H), 2, [&](size_t y0, size_t y1, unsigned slot) {
+            for (size_t y = y0; y < y1; ++y) {
+                for (int x = 0; x < W; ++x) {
+                    double u = (2.0 * (x + 0.5) / W - 1.0) * view.aspect * view.tanHalfFov;
+                    double v = (1.0 - 2.0 * (y + 0.5) / H) * view.tanHalfFov;
+                    GeodesicRay ray = initGeodesic(view.pos, view.tangentDir(u, v), tp.rs);
+                    GeodesicResult res = traceGeodesic(ray, p);
+                    if (res.termination != RayTermination::Disk || res.firstDisk.g <= 0.0) continue;
+                    double q = 1.0 + u*u + v*v;
+                    TransferSample s;
+                    s.r = float(res.firstDisk.r);
+                    s.azimuth = float(res.firstDisk.azimuth);
+                    s.g = float(res.firstDisk.g);
+                    s.delay = float(res.firstDisk.t);
+                    s.dOmega = float(du * dv / (q * std::sqrt(q)));
+                    s.u = float(u);
+                    s.v = float(v);
+                    s.pixel = uint32_t(y * W + x);
+                    local[slot].push_back(s);
+                }
+            }
+        });
+        for (auto& l : local) dt.samples.insert(dt.samples.end(), l.begin(), l.end());
+        std::sort(dt.samples.begin(), dt.samples.end(),
+                  [](const TransferSample& a, const TransferSample& b) { return a.r < b.r; });
+        return dt;
+    }
+
+    bool save(const std::string& path) const {
+        FILE* f = std::fopen(path.c_str(), "wb");
+        if (!f) return false;
+        const char magic[8] = { 'B','H','X','F','E','R','0','1' };
+        uint64_t n = samples.size();
+        std::fwrite(magic, 1, 8, f);
+        std::fwrite(&width, sizeof(int), 1, f);
+        std::fwrite(&height, sizeof(int), 1, f);
+        const double meta[6] = { rs, distance, inclination, tanHalfFov, diskInner, diskOuter };
+        std::fwrite(meta, sizeof(double), 6, f);
+        std::fwrite(&n, sizeof(n), 1, f);
+        std::fwrite(samples.data(), sizeof(TransferSample), samples.size(), f);
+        return std::fclose(f) == 0;
+    }
+
+    bool load(const std::string& path) {
+        FILE* f = std::fopen(path.c_str(), "rb");
+        if (!f) return false;
+        char magic[8];
+        uint64_t n = 0;
+        double meta[6];
+        bool ok = std::fread(magic, 1, 8, f) == 8 && std::string(magic, 8) == "BHXFER01"
+               && std::fread(&width, sizeof(int), 1, f) == 1
+               && std::fread(&height, sizeof(int), 1, f) == 1
+               && std::fread(meta, sizeof(double), 6, f) == 6
+               && std::fread(&n, sizeof(n), 1, f) == 1;
+        if (ok) {
+            rs = meta[0]; distance = meta[1]; inclination = meta[2];
+            tanHalfFov = meta[3]; diskInner = meta[4]; diskOuter = meta[5];
+            samples.resize(n);
+            ok = std::fread(samples.data(), sizeof(TransferSample), n, f) == n;
+        }
+        std::fclose(f);
+        return ok;
+    }
+};
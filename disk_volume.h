@@ -0,0 +1,75 @@
+#pragma once
+// Thick-disk density model and its coarse occupancy grid.
+//
+// The disk is a Gaussian slab of scale height H (the `thickness` uploaded in
+// the Disk UBO) between r1 and r2 with soft radial edges. The grid stores a
+// conservative upper bound of the density per (R, |y|) cell, dilated by one
+// cell, so geodesic.comp can take long steps wherever the bound is zero and
+// only march finely inside matter. diskDensity() must match geodesic.comp.
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+inline float smoothstepf(float e0, float e1, float x) {
+    float t = std::clamp((x - e0) / (e1 - e0), 0.0f, 1.0f);
+    return t * t * (3.0f - 2.0f * t);
+}
+
+struct DiskVolumeGrid {
+    static constexpr int NR = 64;   // cells along the cylindrical radius R
+    static constexpr int NZ = 32;   // cells along |y|
+    static constexpr float EMPTY = 1e-4f;   // densities below this are treated as vacuum
+
+    float r1 = 0.0f, r2 = 0.0f, thickness = 0.0f;
+    float rMax = 0.0f, zMax = 0.0f;
+    std::vector<float> maxDensity;   // NR × NZ, row-major in |y|
+
+    float radialProfile(float R) const {
+        float edge = 0.05f * (r2 - r1);
+        return smoothstepf(r1 - edge, r1 + edge, R) * (1.0f - smoothstepf(r2 - edge, r2 + edge, R));
+    }
+    float verticalProfile(float y) const {
+        float z = y / thickness;
+        return std::exp(-0.5f * z * z);
+    }
+    float density(float R, float y) const { return radialProfile(R) * verticalProfile(y); }
+
+    static DiskVolumeGrid build(float r1, float r2, float thickness) {
+        DiskVolumeGrid g;
+        g.r1 = r1; g.r2 = r2; g.thickness = thickness;
+        float edge = 0.05f * (r2 - r1);
+        g.rMax = (r2 + edge) * 1.05f;
+        // the Gaussian drops below EMPTY at |y| = sqrt(-2 ln EMPTY) H ≈ 4.3 H
+        g.zMax = 5.0f * thickness;
+
+        std::vector<float> raw(NR * NZ, 0.0f);
+        const float dR = g.rMax / NR, dZ = g.zMax / NZ;
+        for (int iz = 0; iz < NZ; ++iz) {
+            float vMax = g.verticalProfile(iz * dZ);   // decreasing in |y|: max at the cell's lower edge
+            for (int ir = 0; ir < NR; ++ir) {
+                float a = ir * dR, b = a + dR;
+                // radial profile is a plateau with monotone edges, so the max is at an
+                // end point unless the cell overlaps the plateau
+                float rMaxCell = std::max(g.radialProfile(a), g.radialProfile(b));
+                if (b > r1 + edge && a < r2 - edge) rMaxCell = 1.0f;
+                float m = rMaxCell * vMax;
+                raw[iz * NR + ir] = m > EMPTY ? m : 0.0f;
+            }
+        }
+        // dilate by one cell so steps capped at one cell can never skip over matter
+        g.maxDensity.assign(NR * NZ, 0.0f);
+        for (int iz = 0; iz < NZ; ++iz)
+            for (int ir = 0; ir < NR; ++ir) {
+                float m = 0.0f;
+                for (int dz = -1; dz <= 1; ++dz)
+                    for (int dr = -1; dr <= 1; ++dr) {
+                        int z = std::abs(iz + dz);   // mirror across the midplane
+                        int r = ir + dr;
+                        if (z >= NZ || r < 0 || r >= NR) continue;
+                        m = std::max(m, raw[z * NR + r]);
+                    }
+                g.maxDensity[iz * NR + ir] = m;
+            }
+        return g;
+    }
+};
@@ -0,0 +1,176 @@
+#pragma once
+// Precomputed disk emission tables, shared by geodesic.comp and the CPU renderers.
+//
+//  - blackbodyRGB: linear sRGB chromaticity of a blackbody, CIE 1931 integrated,
+//    indexed by log10 of the *observed* temperature. Redshift needs no second
+//    axis: g³ B_{ν/g}(T) = B_ν(gT), so a shifted blackbody is a blackbody at gT.
+//  - flux: Novikov–Thorne (Page–Thorne) flux of a Schwarzschild disk with a
+//    zero-torque inner edge at the ISCO, normalised to its peak, over
+//    [rIn, rOut]; zero inside the ISCO when rIn is below it.
+//
+// Shading a disk hit is then one lookup in each table:
+//   T = tMax · F^¼,  color = blackbody(gT) · F · g⁴ · exposure
+#include <glm/glm.hpp>
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+struct EmissionTables {
+    static constexpr int BLACKBODY_SIZE = 256;
+    static constexpr int FLUX_SIZE = 256;
+
+    float logTMin = 3.0f, logTMax = 8.0f;   // table range, log10 Kelvin
+    float rIn = 0.0f, rOut = 0.0f;          // disk annulus, meters
+    float rs = 0.0f;
+    float tMax = 0.0f;                      // temperature at the flux peak, Kelvin
+    std::vector<float> blackbodyRGB;        // 3 × BLACKBODY_SIZE
+    std::vector<float> flux;                // FLUX_SIZE, F / F_max
+
+    // -- build -- //
+    static EmissionTables build(double rIn, double rOut, double rs, double tMax) {
+        EmissionTables t;
+        t.rIn = float(rIn); t.rOut = float(rOut); t.rs = float(rs); t.tMax = float(tMax);
+        t.buildBlackbody();
+        t.buildFlux();
+        return t;
+    }
+
+    // Multi-lobe Gaussian fit of the CIE 1931 2° observer (Wyman, Sloan & Shirley 2013).
+    static glm::dvec3 cieXYZ(double nm) {
+        auto g = [](double x, double mu, double s1, double s2) {
+            double t = (x - mu) / (x < mu ? s1 : s2);
+            return std::exp(-0.5 * t * t);
+        };
+        return glm::dvec3(
+            1.056 * g(nm, 599.8, 37.9, 31.0) + 0.362 * g(nm, 442.0, 16.0, 26.7) - 0.065 * g(nm, 501.1, 20.4, 26.2),
+            0.821 * g(nm, 568.8, 46.9, 40.5) + 0.286 * g(nm, 530.9, 16.3, 31.1),
+            1.217 * g(nm, 437.0, 11.8, 36.0) + 0.681 * g(nm, 459.0, 26.0, 13.8));
+    }
+
+    void buildBlackbody() {
+        const double h = 6.62607015e-34, k = 1.380649e-23, c = 299792458.0;
+        blackbodyRGB.assign(3 * BLACKBODY_SIZE, 0.0f);
+        for (int i = 0; i < BLACKBODY_SIZE; ++i) {
+            double T = std::pow(10.0, logTMin + (logTMax - logTMin) * i / (BLACKBODY_SIZE - 1));
+            glm::dvec3 xyz(0.0);
+            for (double nm = 380.0; nm <= 780.0; nm += 5.0) {
+                double lam = nm * 1e-9;
+                double x = h * c / (lam * k * T);
+                double B = x > 700.0 ? 0.0 : 1.0 / (lam*lam*lam*lam*lam * std::expm1(x));
+                xyz += cieXYZ(nm) * B;
+            }
+            glm::dvec3 rgb( 3.2406 * xyz.x - 1.5372 * xyz.y - 0.4986 * xyz.z,
+                           -0.9689 * xyz.x + 1.8758 * xyz.y + 0.0415 * xyz.z,
+                            0.0557 * xyz.x - 0.2040 * xyz.y + 1.0570 * xyz.z);
+            rgb = glm::max(rgb, 0.0);
+            double m = std::max(rgb.x, std::max(rgb.y, rgb.z));
+            if (m > 0.0) rgb /= m;
+            blackbodyRGB[3*i+0] = float(rgb.x);
+            blackbodyRGB[3*i+1] = float(rgb.y);
+            blackbodyRGB[3*i+2] = float(rgb.z);
+        }
+    }
+
+    // F(r) ∝ -Ω' / (E - ΩL)² · ∫_{r_0}^{r} (E - ΩL) L' dr   (geometric units, M = 1)
+    // with the torque-free edge r_0 at the ISCO (6M = 3 rs) or rIn if that is
+    // further out. Parts of [rIn, rOut] inside r_0 have no stable orbits and emit nothing.
+    void buildFlux() {
+        flux.assign(FLUX_SIZE, 0.0f);
+        const double M = 0.5 * rs;
+        const double xs = rIn / M;
+        const double xe = std::max(rOut / M, xs * (1.0 + 1e-6));
+        const double x0 = std::max(xs, 6.0);
+        auto E = [](double x) { return (1.0 - 2.0/x) / std::sqrt(1.0 - 3.0/x); };
+        auto L = [](double x) { return std::sqrt(x) / std::sqrt(1.0 - 3.0/x); };
+        auto W = [](double x) { return std::pow(x, -1.5); };
+
+        const int SUB = 64;   // integration substeps per table entry
+        double integral = 0.0, xPrev = x0, peak = 0.0;
+        std::vector<double> raw(FLUX_SIZE, 0.0);
+        for (int i = 1; i < FLUX_SIZE; ++i) {
+            double xi = xs + (xe - xs) * i / (FLUX_SIZE - 1);
+            if (xi <= x0) continue;
+            for (int s = 1; s <= SUB; ++s) {
+                double xa = xPrev + (xi - xPrev) * (s - 1) / SUB;
+                double xb = xPrev + (xi - xPrev) * s / SUB;
+                double xm = 0.5 * (xa + xb), dx = 1e-4 * xm;
+                double dL = (L(xm + dx) - L(xm - dx)) / (2.0 * dx);
+                integral += (E(xm) - W(xm) * L(xm)) * dL * (xb - xa);
+            }
+            xPrev = xi;
+            double dW = 1.5 * std::pow(xi, -2.5);   // -Ω'
+            double d = E(xi) - W(xi) * L(xi);
+            raw[i] = std::max(0.0, dW / (d * d) * integral / xi);
+            peak = std::max(peak, raw[i]);
+        }
+        for (int i = 0; i < FLUX_SIZE; ++i) flux[i] = float(peak > 0.0 ? raw[i] / peak : 0.0);
+    }
+
+    // -- lookups, matching linear texture filtering on the GPU -- //
+    static float lerpTable(const std::vector<float>& tab, int stride, int comp, int n, double x) {
+        double f = std::clamp(x, 0.0, 1.0) * (n - 1);
+        int i = std::min(int(f), n - 2);
+        double w = f - i;
+        return float((1.0 - w) * tab[i * stride + comp] + w * tab[(i + 1) * stride + comp]);
+    }
+
+    glm::vec3 blackbody(double T) const {
+        double x = (std::log10(std::max(T, 1.0)) - logTMin) / (logTMax - logTMin);
+        return glm::vec3(lerpTable(blackbodyRGB, 3, 0, BLACKBODY_SIZE, x),
+                         lerpTable(blackbodyRGB, 3, 1, BLACKBODY_SIZE, x),
+                         lerpTable(blackbodyRGB, 3, 2, BLACKBODY_SIZE, x));
+    }
+
+    double fluxAt(double r) const {
+        if (r < rIn || r > rOut) return 0.0;
+        return lerpTable(flux, 1, 0, FLUX_SIZE, (r - rIn) / (rOut - rIn));
+    }
+
+    glm::vec3 shadeDisk(double r, double g, double exposure = 1.0) const {
+        double F = fluxAt(r);
+        if (F <= 0.0 || g <= 0.0) return glm::vec3(0.0f);
+        double T = tMax * std::sqrt(std::sqrt(F));
+        double g2 = g * g;
+        return blackbody(g * T) * float(F * g2 * g2 * exposure);
+    }
+
+    // -- file cache -- //
+    bool save(const std::string& path) const {
+        FILE* f = std::fopen(path.c_str(), "wb");
+        if (!f) return false;
+        const char magic[8] = { 'B','H','E','M','I','T','0','1' };
+        const int32_t sizes[2] = { BLACKBODY_SIZE, FLUX_SIZE };
+        const float params[6] = { logTMin, logTMax, rIn, rOut, rs, tMax };
+        std::fwrite(magic, 1, 8, f);
+        std::fwrite(sizes, sizeof(int32_t), 2, f);
+        std::fwrite(params, sizeof(float), 6, f);
+        std::fwrite(blackbodyRGB.data(), sizeof(float), blackbodyRGB.size(), f);
+        std::fwrite(flux.data(), sizeof(float), flux.size(), f);
+        return std::fclose(f) == 0;
+    }
+
+    bool load(const std::string& path) {
+        FILE* f = std::fopen(path.c_str(), "rb");
+        if (!f) return false;
+        char magic[8];
+        int32_t sizes[2];
+        float params[6];
+        bool ok = std::fread(magic, 1, 8, f) == 8 && std::string(magic, 8) == "BHEMIT01"
+               && std::fread(sizes, sizeof(int32_t), 2, f) == 2
+               && sizes[0] == BLACKBODY_SIZE && sizes[1] == FLUX_SIZE
+               && std::fread(params, sizeof(float), 6, f) == 6;
+        if (ok) {
+            logTMin = params[0]; logTMax = params[1]; rIn = params[2];
+            rOut = params[3]; rs = params[4]; tMax = params[5];
+            blackbodyRGB.resize(3 * BLACKBODY_SIZE);
+            flux.resize(FLUX_SIZE);
+            ok = std::fread(blackbodyRGB.data(), sizeof(float), blackbodyRGB.size(), f) == blackbodyRGB.size()
+              && std::fread(flux.data(), sizeof(float), flux.size(), f) == flux.size();
+        }
+        std::fclose(f);
+        return ok;
+    }
+};
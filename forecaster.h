@@ -0,0 +1,273 @@
+#pragma once
+// Background forecasts of where the bodies are heading, for drawing.
+//
+// A forecast integrates a copy of the bodies from one state on the
+// forecaster's own thread (kick-drift-kick leapfrog with a step set by the
+// tightest pair's dynamical time, so close passes are resolved and quiet
+// stretches are crossed in long steps, but never below minStep so a close
+// pass cannot eat the step budget) and keeps each body's path through a
+// TrajectoryDecimator. It runs in chunks of simulated time and publishes the
+// paths after each one, so a forecast grows towards its horizon while the
+// caller keeps drawing whatever latest() last handed out.
+//
+// update() restarts the forecast only when the live bodies leave it: a body
+// was added or removed, or one is further from its forecast position than
+// restartError · r (r its distance from the origin, at least its radius).
+// A restart cancels the running forecast at its next step; latest() keeps
+// returning the previous one until the new one has published a chunk.
+#include "trajectory_recorder.h"
+#include <glm/glm.hpp>
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+struct ForecastBody {
+    glm::dvec3 pos{0.0};      // m
+    glm::dvec3 vel{0.0};      // m/s
+    double gm = 0.0;          // G · mass (m^3/s^2)
+    double radius = 0.0;      // lighter bodies that come this close are captured (m)
+};
+
+struct ForecastPath {
+    std::vector<glm::vec3> points;   // decimated, the last one at the forecast's reach
+    std::vector<float> times;        // seconds after the forecast's start
+    bool captured = false;           // ends inside a heavier body
+};
+
+struct Forecast {
+    uint64_t generation = 0;         // changes with every restart; 0 before the first
+    double start = 0.0;              // caller's time of the state it started from
+    double reached = 0.0;            // seconds forecast so far
+    bool complete = false;           // reached the horizon
+    bool truncated = false;          // stopped short of it at the step limit
+    std::vector<ForecastPath> paths; // one per body, in input order
+
+    // Forecast position of body i at `seconds` after start, if it got that far.
+    bool positionAt(size_t i, double seconds, glm::dvec3& out) const {
+        if (i >= paths.size() || seconds > reached) return false;
+        const ForecastPath& p = paths[i];
+        if (p.points.empty() || seconds > p.times.back()) return false;
+        size_t k = std::upper_bound(p.times.begin(), p.times.end(), float(seconds)) - p.times.begin();
+        if (k == 0) { out = glm::dvec3(p.points[0]); return true; }
+        if (k == p.times.size()) { out = glm::dvec3(p.points.back()); return true; }
+        double span = double(p.times[k]) - p.times[k - 1];
+        double w = span > 0.0 ? (seconds - p.times[k - 1]) / span : 0.0;
+        out = glm::dvec3(p.points[k - 1]) * (1.0 - w) + glm::dvec3(p.points[k]) * w;
+        return true;
+    }
+};
+
+struct ForecastOptions {
+    double horizon = 2e5;        // seconds to forecast
+    double chunk = 1e4;          // seconds between publications
+    double accuracy = 0.01;      // step = accuracy · tightest dynamical time
+    double minStep = 1.0;        // seconds; black_hole.cpp's per-frame step, which resolves no finer
+    double maxStep = 500.0;      // seconds
+    double tolerance = 2e-3;     // decimation error, relative to the distance from the origin
+    double restartError = 0.02;  // relative divergence that triggers a new forecast
+    size_t maxSteps = 2000000;   // per forecast
+};
+
+class TrajectoryForecaster {
+public:
+
+    explicit TrajectoryForecaster(ForecastOptions o = ForecastOptions()) : opt(o) {
+        worker = std::thread([this] { run(); });
+    }
+    ~TrajectoryForecaster() {
+        {
+            std::lock_guard<std::mutex> lock(mtx);
+            stopping = true;
+            ++generation;
+        }
+        cv.notify_all();
+        worker.join();
+    }
+
+    // Starts a forecast from bodies at time t, cancelling the current one.
+    void restart(std::vector<ForecastBody> bodies, double t) {
+        {
+            std::lock_guard<std::mutex> lock(mtx);
+            job = std::move(bodies);
+            jobStart = t;
+            jobGeneration = ++generation;
+            hasJob = true;
+            started = job;
+            startedAt = t;
+        }
+        cv.notify_all();
+    }
+
+    // Compares the live bodies at time t with the forecast and restarts it if
+    // they have left it. Cheap enough to call every frame; true on a restart.
+    bool update(const std::vector<ForecastBody>& bodies, double t) {
+        bool restartNow;
+        {
+            std::lock_guard<std::mutex> lock(mtx);
+            restartNow = generation == 0 || bodies.size() != started.size();
+            for (size_t i = 0; i < bodies.size() && !restartNow; ++i)
+                restartNow = bodies[i].gm != started[i].gm;
+            if (!restartNow && published.generation == generation) {
+                double ahead = t - startedAt;
+                if (ahead > published.reached) {
+                    restartNow = published.complete || published.truncated;   // ran past a finished forecast
+                } else {
+                    for (size_t i = 0; i < bodies.size() && !restartNow; ++i) {
+                        glm::dvec3 expect;
+                        if (!published.positionAt(i, ahead, expect)) continue;   // captured
+                        double r = std::max(glm::length(bodies[i].pos), std::max(bodies[i].radius, 1.0));
+                        restartNow = glm::length(bodies[i].pos - expect) > opt.restartError * r;
+                    }
+                }
+            }
+        }
+        if (restartNow) restart(bodies, t);
+        return restartNow;
+    }
+
+    // Copies the newest published forecast into out if it is newer than what
+    // out holds; never waits for the integration.
+    bool latest(Forecast& out) {
+        std::lock_guard<std::mutex> lock(mtx);
+        if (published.generation == out.generation && published.reached == out.reached) return false;
+        out = published;
+        return true;
+    }
+
+    void cancel() {
+        std::lock_guard<std::mutex> lock(mtx);
+        ++generation;
+        hasJob = false;
+        published = Forecast();
+        started.clear();
+    }
+
+private:
+    void run() {
+        std::unique_lock<std::mutex> lock(mtx);
+        for (;;) {
+            cv.wait(lock, [this] { return hasJob || stopping; });
+            if (stopping) return;
+            std::vector<ForecastBody> bodies = std::move(job);
+            double t0 = jobStart;
+            uint64_t gen = jobGeneration;
+            hasJob = false;
+            lock.unlock();
+            integrate(std::move(bodies), t0, gen);
+            lock.lock();
+        }
+    }
+
+    static void accelerations(const std::vector<ForecastBody>& b, const std::vector<uint8_t>& gone,
+                              std::vector<glm::dvec3>& acc) {
+        acc.assign(b.size(), glm::dvec3(0.0));
+        for (size_t i = 0; i < b.size(); ++i) {
+            if (gone[i]) continue;
+            for (size_t j = i + 1; j < b.size(); ++j) {
+                if (gone[j]) continue;
+                glm::dvec3 d = b[j].pos - b[i].pos;
+                double r2 = glm::dot(d, d);
+                if (r2 <= 0.0) continue;
+                glm::dvec3 f = d / (r2 * std::sqrt(r2));
+                acc[i] += b[j].gm * f;
+                acc[j] -= b[i].gm * f;
+            }
+        }
+    }
+
+    // accuracy · the shortest of sqrt(r^3 / G(m_i + m_j)) and r / |v_i - v_j| over pairs.
+    double stepSize(const std::vector<ForecastBody>& b, const std::vector<uint8_t>& gone) const {
+        double tight = opt.maxStep / opt.accuracy;
+        for (size_t i = 0; i < b.size(); ++i)
+            for (size_t j = i + 1; j < b.size(); ++j) {
+                if (gone[i] || gone[j] || b[i].gm + b[j].gm <= 0.0) continue;
+                double r = glm::length(b[j].pos - b[i].pos);
+                double v = glm::length(b[j].vel - b[i].vel);
+                tight = std::min(tight, std::sqrt(r * r * r / (b[i].gm + b[j].gm)));
+                if (v > 0.0) tight = std::min(tight, r / v);
+            }
+        return std::clamp(opt.accuracy * tight, opt.minStep, opt.maxStep);
+    }
+
+    void integrate(std::vector<ForecastBody> b, double t0, uint64_t gen) {
+        const size_t n = b.size();
+        Forecast f;
+        f.generation = gen;
+        f.start = t0;
+        f.paths.resize(n);
+        std::vector<TrajectoryDecimator> dec(n, TrajectoryDecimator(opt.tolerance, 1.0));
+        std::vector<uint8_t> gone(n, 0);
+        std::vector<glm::dvec3> acc;
+        double t = 0.0, tPrev = 0.0;
+        auto keep = [&](size_t i, const glm::dvec3& q, double at) {
+            f.paths[i].points.push_back(glm::vec3(q));
+            f.paths[i].times.push_back(float(at));
+        };
+        for (size_t i = 0; i < n; ++i)
+            dec[i].add(b[i].pos, [&](const glm::dvec3& q) { keep(i, q, 0.0); });
+
+        accelerations(b, gone, acc);
+        size_t steps = 0;
+        while (t < opt.horizon && steps < opt.maxSteps) {
+            double chunkEnd = std::min(t + opt.chunk, opt.horizon);
+            while (t < chunkEnd && steps < opt.maxSteps) {
+                if (generation.load() != gen) return;   // superseded
+                double dt = std::min(stepSize(b, gone), chunkEnd - t);
+                for (size_t i = 0; i < n; ++i)
+                    if (!gone[i]) { b[i].vel += 0.5 * dt * acc[i]; b[i].pos += dt * b[i].vel; }
+                accelerations(b, gone, acc);
+                for (size_t i = 0; i < n; ++i)
+                    if (!gone[i]) b[i].vel += 0.5 * dt * acc[i];
+                tPrev = t;
+                t += dt;
+                ++steps;
+                for (size_t i = 0; i < n; ++i) {
+                    if (gone[i]) continue;
+                    // past the first point the decimator only ever commits the previous one
+                    dec[i].add(b[i].pos, [&](const glm::dvec3& q) { keep(i, q, tPrev); });
+                    for (size_t j = 0; j < n; ++j)
+                        if (j != i && !gone[j] && b[j].gm > b[i].gm
+                            && glm::length(b[i].pos - b[j].pos) < b[j].radius) {
+                            dec[i].finish([&](const glm::dvec3& q) { keep(i, q, t); });
+                            f.paths[i].captured = true;
+                            gone[i] = 1;
+                            break;
+                        }
+                }
+            }
+            f.reached = t;
+            f.complete = t >= opt.horizon;
+            f.truncated = !f.complete && steps >= opt.maxSteps;
+            publish(f, b, t, gone);
+        }
+    }
+
+    // Publishes f with each live path extended to its current point, which the
+    // decimator has not committed to yet.
+    void publish(const Forecast& f, const std::vector<ForecastBody>& b, double t, const std::vector<uint8_t>& gone) {
+        Forecast out = f;
+        for (size_t i = 0; i < out.paths.size(); ++i)
+            if (!gone[i] && (out.paths[i].times.empty() || out.paths[i].times.back() < float(t))) {
+                out.paths[i].points.push_back(glm::vec3(b[i].pos));
+                out.paths[i].times.push_back(float(t));
+            }
+        std::lock_guard<std::mutex> lock(mtx);
+        if (generation.load() == f.generation) published = std::move(out);
+    }
+
+    ForecastOptions opt;
+    std::mutex mtx;
+    std::condition_variable cv;
+    std::atomic<uint64_t> generation{0};
+    std::vector<ForecastBody> job, started;   // started: the state the current forecast began from
+    double jobStart = 0.0, startedAt = 0.0;
+    uint64_t jobGeneration = 0;
+    bool hasJob = false, stopping = false;
+    Forecast published;
+    std::thread worker;
+};
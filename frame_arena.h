@@ -0,0 +1,131 @@
+#pragma once
+// Frame-scoped scratch memory for the interactive apps.
+//
+// A FrameArena hands out memory by bumping an offset through its blocks and
+// frees everything at once with reset() at the frame boundary. A frame that
+// outgrows the arena chains another block; the next reset() merges all of
+// them into one block of the combined size, so once the per-frame working
+// set has been seen, frames allocate nothing from the heap.
+//
+// FrameAllocator<T> lets standard containers draw from an arena
+// (FrameVector<T>). Their storage is only valid until the arena is reset or
+// rewound past it; freeing the most recent allocation gives its bytes back,
+// so a growing vector that is alone at the top reuses its old space.
+//
+// threadFrameArena() is one arena per thread: the render loop resets the
+// main thread's at the start of each frame, and worker tasks bracket their
+// scratch with a FrameArena::Scope on their own.
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+class FrameArena {
+public:
+    explicit FrameArena(size_t initialBytes = size_t(1) << 16) : initialBytes(initialBytes) {}
+    FrameArena(const FrameArena&) = delete;
+    FrameArena& operator=(const FrameArena&) = delete;
+
+    void* allocate(size_t bytes, size_t align = alignof(std::max_align_t)) {
+        for (;;) {
+            if (current < blocks.size()) {
+                Block& b = blocks[current];
+                uintptr_t base = reinterpret_cast<uintptr_t>(b.data.get());
+                uintptr_t p = (base + top + align - 1) & ~uintptr_t(align - 1);
+                if (p + bytes <= base + b.size) {
+                    top = size_t(p - base) + bytes;
+                    return reinterpret_cast<void*>(p);
+                }
+                if (current + 1 < blocks.size()) { ++current; top = 0; continue; }
+            }
+            // out of space for this frame: chain a block, merged on the next reset()
+            size_t last = blocks.empty() ? initialBytes : blocks.back().size;
+            addBlock(std::max(bytes + align, 2 * last));
+            current = blocks.size() - 1;
+            top = 0;
+        }
+    }
+
+    // Only the most recent allocation is actually returned.
+    void deallocate(void* p, size_t bytes) {
+        if (current >= blocks.size()) return;
+        unsigned char* base = blocks[current].data.get();
+        if (static_cast<unsigned char*>(p) + bytes == base + top)
+            top = size_t(static_cast<unsigned char*>(p) - base);
+    }
+
+    struct Marker { size_t block, top; };
+    Marker mark() const { return { current, top }; }
+    // Frees everything allocated since m.
+    void rewind(Marker m) { current = m.block; top = m.top; }
+
+    // Frees the frame's allocations; blocks chained during it become one.
+    void reset() {
+        if (blocks.size() > 1) {
+            size_t total = 0;
+            for (const Block& b : blocks) total += b.size;
+            blocks.clear();
+            addBlock(total);
+        }
+        current = 0;
+        top = 0;
+    }
+
+    size_t capacity() const {
+        size_t total = 0;
+        for (const Block& b : blocks) total += b.size;
+        return total;
+    }
+    size_t heapBlocks() const { return blockAllocations; }   // blocks ever taken from the heap
+
+    // Rewinds the arena on scope exit; for scratch inside a worker task.
+    class Scope {
+    public:
+        explicit Scope(FrameArena& a) : arena(a), m(a.mark()) {}
+        ~Scope() { arena.rewind(m); }
+        Scope(const Scope&) = delete;
+        Scope& operator=(const Scope&) = delete;
+    private:
+        FrameArena& arena;
+        Marker m;
+    };
+
+private:
+    struct Block {
+        std::unique_ptr<unsigned char[]> data;
+        size_t size;
+    };
+    void addBlock(size_t bytes) {
+        blocks.push_back({ std::unique_ptr<unsigned char[]>(new unsigned char[bytes]), bytes });
+        ++blockAllocations;
+    }
+
+    size_t initialBytes;
+    std::vector<Block> blocks;
+    size_t current = 0, top = 0;
+    size_t blockAllocations = 0;
+};
+
+inline FrameArena& threadFrameArena() {
+    thread_local FrameArena arena;
+    return arena;
+}
+
+template <class T>
+struct FrameAllocator {
+    using value_type = T;
+    FrameArena* arena;
+
+    FrameAllocator() noexcept : arena(&threadFrameArena()) {}
+    explicit FrameAllocator(FrameArena& a) noexcept : arena(&a) {}
+    template <class U> FrameAllocator(const FrameAllocator<U>& o) noexcept : arena(o.arena) {}
+
+    T* allocate(size_t n) { return static_cast<T*>(arena->allocate(n * sizeof(T), alignof(T))); }
+    void deallocate(T* p, size_t n) noexcept { arena->deallocate(p, n * sizeof(T)); }
+
+    template <class U> bool operator==(const FrameAllocator<U>& o) const { return arena == o.arena; }
+    template <class U> bool operator!=(const FrameAllocator<U>& o) const { return arena != o.arena; }
+};
+
+template <class T> using FrameVector = std::vector<T, FrameAllocator<T>>;
@@ -0,0 +1,63 @@
+#pragma once
+// Per-pixel geodesic results ("G-buffer") for the headless renderers.
+//
+// Tracing is the expensive part; shading from a GSample is a few flops. Tools
+// that need several shadings of one view (bands, emission models, disk
+// parameters inside the traced annulus) trace once and shade many times.
+#include "geodesic_core.h"
+#include "observer.h"
+#include "parallel.h"
+#include <cstdint>
+#include <vector>
+
+enum class GSampleKind : uint8_t { Sky = 0, Hole = 1, Disk = 2 };
+
+struct GSample {
+    GSampleKind kind = GSampleKind::Sky;
+    float r = 0.0f;         // disk landing radius, meters
+    float azimuth = 0.0f;   // disk azimuth, see DiskCrossing
+    float g = 0.0f;         // ν_obs / ν_em at the disk
+    float delay = 0.0f;     // c·t to the disk, meters
+    float dir[3] = {0, 0, 0};   // asymptotic direction for sky pixels
+};
+
+inline GSample traceSample(const ObserverView& view, const glm::dvec3& dir, const TraceParams& tp) {
+    GeodesicRay ray = initGeodesic(view.pos, dir, tp.rs);
+    GeodesicResult res = traceGeodesic(ray, tp);
+    GSample s;
+    if (res.termination == RayTermination::Disk) {
+        s.kind = GSampleKind::Disk;
+        s.r = float(res.firstDisk.r);
+        s.azimuth = float(res.firstDisk.azimuth);
+        s.g = float(res.firstDisk.g);
+        s.delay = float(res.firstDisk.t);
+    } else if (res.termination == RayTermination::Captured) {
+        s.kind = GSampleKind::Hole;
+    } else {
+        s.kind = GSampleKind::Sky;
+    }
+    s.dir[0] = float(res.direction.x);
+    s.dir[1] = float(res.direction.y);
+    s.dir[2] = float(res.direction.z);
+    return s;
+}
+
+// Traces rows [y0, y1) of a W×H view into out (row-major, full-frame indexing).
+inline void traceGBufferRows(const ObserverView& view, int W, int H, int y0, int y1,
+                             const TraceParams& tp, std::vector<GSample>& out,
+                             ThreadPool& pool = defaultPool()) {
+    TraceParams p = tp;
+    p.stopAtDisk = true;
+    pool.parallelFor(size_t(y0), size_t(y1), 1, [&](size_t r0, size_t r1, unsigned) {
+        for (size_t y = r0; y < r1; ++y)
+            for (int x = 0; x < W; ++x)
+                out[y * W + x] = traceSample(view, view.pixelDir(x, double(y), W, H), p);
+    });
+}
+
+inline std::vector<GSample> traceGBuffer(const ObserverView& view, int W, int H,
+                                         const TraceParams& tp, ThreadPool& pool = defaultPool()) {
+    std::vector<GSample> gbuf(size_t(W) * H);
+    traceGBufferRows(view, W, H, 0, H, tp, gbuf, pool);
+    return gbuf;
+}
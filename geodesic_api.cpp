@@ -0,0 +1,124 @@
+// libgeodesic: C entry points over geodesic_core.h and parallel.h.
+#include "geodesic_api.h"
+#include "geodesic_core.h"
+#include "parallel.h"
+#include <cmath>
+#include <limits>
+
+struct geodesic_context {
+    ThreadPool pool;
+    explicit geodesic_context(unsigned threads) : pool(threads) {}
+};
+
+namespace {
+
+constexpr size_t BATCH_GRAIN = 256;
+
+template <class T> inline void store(T* dst, size_t i, T v) { if (dst) dst[i] = v; }
+
+void traceOne(const TraceParams& tp, const geodesic_rays& in, geodesic_results& out, size_t i) {
+    const double nan = std::numeric_limits<double>::quiet_NaN();
+    glm::dvec3 pos(in.ox[i], in.oy[i], in.oz[i]);
+    glm::dvec3 dir(in.dx[i], in.dy[i], in.dz[i]);
+    double dirLen = glm::length(dir);
+    if (!(glm::length(pos) > 1.01 * tp.rs) || !(dirLen > 0.0) || !std::isfinite(dirLen)) {
+        store(out.termination, i, int32_t(GEODESIC_INVALID));
+        store(out.px, i, pos.x); store(out.py, i, pos.y); store(out.pz, i, pos.z);
+        store(out.vx, i, nan); store(out.vy, i, nan); store(out.vz, i, nan);
+        store(out.affine_length, i, 0.0);
+        store(out.steps, i, int32_t(0));
+        store(out.disk_crossings, i, int32_t(0));
+        store(out.disk_r, i, nan); store(out.disk_azimuth, i, nan); store(out.disk_g, i, nan);
+        store(out.disk_t, i, nan); store(out.disk_lambda, i, nan);
+        return;
+    }
+    GeodesicRay ray = initGeodesic(pos, dir, tp.rs);
+    GeodesicResult res = traceGeodesic(ray, tp);
+    bool hit = res.diskCrossings > 0;
+    store(out.termination, i, int32_t(res.termination));
+    store(out.px, i, res.position.x); store(out.py, i, res.position.y); store(out.pz, i, res.position.z);
+    store(out.vx, i, res.direction.x); store(out.vy, i, res.direction.y); store(out.vz, i, res.direction.z);
+    store(out.affine_length, i, res.lambda);
+    store(out.steps, i, int32_t(res.steps));
+    store(out.disk_crossings, i, int32_t(res.diskCrossings));
+    store(out.disk_r, i, hit ? res.firstDisk.r : nan);
+    store(out.disk_azimuth, i, hit ? res.firstDisk.azimuth : nan);
+    store(out.disk_g, i, hit ? res.firstDisk.g : nan);
+    store(out.disk_t, i, hit ? res.firstDisk.t : nan);
+    store(out.disk_lambda, i, hit ? res.firstDisk.lambda : nan);
+}
+
+} // namespace
+
+extern "C" {
+
+int geodesic_version(void) { return GEODESIC_API_VERSION; }
+
+const char* geodesic_error_string(int code) {
+    switch (code) {
+        case GEODESIC_OK:           return "ok";
+        case GEODESIC_ERROR_NULL:   return "missing context, parameters or input array";
+        case GEODESIC_ERROR_PARAMS: return "invalid trace parameters";
+        default:                    return "unknown error";
+    }
+}
+
+double geodesic_schwarzschild_radius(double mass_kg) { return schwarzschildRadius(mass_kg); }
+
+geodesic_context* geodesic_create(unsigned threads) {
+    // nothing may escape into a C caller: out of memory, or a worker thread
+    // the system refuses (std::system_error), both come back as NULL
+    try {
+        return new geodesic_context(threads);
+    } catch (...) {
+        return nullptr;
+    }
+}
+
+void geodesic_destroy(geodesic_context* ctx) { delete ctx; }
+
+unsigned geodesic_thread_count(const geodesic_context* ctx) { return ctx ? ctx->pool.size() : 0; }
+
+void geodesic_default_params(double rs, geodesic_params* out) {
+    if (!out) return;
+    TraceParams tp;
+    out->rs = rs;
+    out->escape_radius = tp.escapeRadius;
+    out->step_scale = tp.stepScale;
+    out->max_steps = tp.maxSteps;
+    out->disk_inner = tp.diskInner;
+    out->disk_outer = tp.diskOuter;
+    out->stop_at_disk = tp.stopAtDisk ? 1 : 0;
+}
+
+int geodesic_check_params(const geodesic_params* params) {
+    if (!params) return GEODESIC_ERROR_NULL;
+    if (!(params->rs > 0.0) || !(params->step_scale > 0.0) || params->max_steps <= 0) return GEODESIC_ERROR_PARAMS;
+    return GEODESIC_OK;
+}
+
+int geodesic_trace_batch(geodesic_context* ctx, const geodesic_params* params, size_t count,
+                         const geodesic_rays* rays, geodesic_results* results) {
+    if (!ctx || !params || !rays || !results) return GEODESIC_ERROR_NULL;
+    if (count == 0) return GEODESIC_OK;
+    if (!rays->ox || !rays->oy || !rays->oz || !rays->dx || !rays->dy || !rays->dz) return GEODESIC_ERROR_NULL;
+    if (int rc = geodesic_check_params(params)) return rc;
+
+    TraceParams tp;
+    tp.rs = params->rs;
+    tp.escapeRadius = params->escape_radius;
+    tp.stepScale = params->step_scale;
+    tp.maxSteps = params->max_steps;
+    tp.diskInner = params->disk_inner;
+    tp.diskOuter = params->disk_outer;
+    tp.stopAtDisk = params->stop_at_disk != 0;
+
+    const geodesic_rays in = *rays;
+    geodesic_results out = *results;
+    ctx->pool.parallelFor(0, count, BATCH_GRAIN, [&](size_t i0, size_t i1, unsigned) {
+        for (size_t i = i0; i < i1; ++i) traceOne(tp, in, out, i);
+    });
+    return GEODESIC_OK;
+}
+
+} // extern "C"
@@ -0,0 +1,132 @@
+/*
+ * libgeodesic: C API over the Schwarzschild geodesic core (geodesic_core.h).
+ *
+ * Rays and results are caller-owned structure-of-arrays buffers; the library
+ * reads and writes them in place and never copies or keeps them. A batch is
+ * split across the context's worker threads. Units follow the core: meters,
+ * coordinate time as c·t in meters, the disk in the y = 0 plane rotating
+ * prograde about +y.
+ *
+ *   geodesic_context* ctx = geodesic_create(0);
+ *   geodesic_params p;
+ *   geodesic_default_params(geodesic_schwarzschild_radius(8.54e36), &p);
+ *   geodesic_rays in = { ox, oy, oz, dx, dy, dz };
+ *   geodesic_results out = { 0 };
+ *   out.termination = term;
+ *   out.disk_r = r;
+ *   geodesic_trace_batch(ctx, &p, n, &in, &out);
+ *   geodesic_destroy(ctx);
+ *
+ * All functions are thread-safe except that one context must not run two
+ * batches at once.
+ */
+#ifndef GEODESIC_API_H
+#define GEODESIC_API_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#if defined(_WIN32)
+#  ifdef GEODESIC_BUILD
+#    define GEODESIC_EXPORT __declspec(dllexport)
+#  else
+#    define GEODESIC_EXPORT __declspec(dllimport)
+#  endif
+#else
+#  define GEODESIC_EXPORT __attribute__((visibility("default")))
+#endif
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define GEODESIC_API_VERSION 2
+
+/* Return codes. */
+#define GEODESIC_OK                0
+#define GEODESIC_ERROR_NULL       -1   /* missing context, params or input array */
+#define GEODESIC_ERROR_PARAMS     -2   /* rs <= 0, step_scale <= 0 or max_steps <= 0 */
+
+/* Per-ray termination classes. */
+#define GEODESIC_INVALID          -1   /* origin inside 1.01 rs or zero direction */
+#define GEODESIC_ESCAPED           0
+#define GEODESIC_CAPTURED          1
+#define GEODESIC_DISK              2   /* stopped at the first disk crossing */
+#define GEODESIC_MAX_STEPS         3
+
+typedef struct geodesic_context geodesic_context;
+
+typedef struct {
+    double rs;              /* Schwarzschild radius, m */
+    double escape_radius;   /* 0 -> 1000 rs */
+    double step_scale;      /* dλ = step_scale · (r - rs) */
+    int32_t max_steps;
+    double disk_inner;      /* disk annulus; inner >= outer disables the disk */
+    double disk_outer;
+    int32_t stop_at_disk;   /* nonzero: terminate at the first crossing */
+} geodesic_params;
+
+/* Ray origins and directions (directions need not be normalised). */
+typedef struct {
+    const double *ox, *oy, *oz;
+    const double *dx, *dy, *dz;
+} geodesic_rays;
+
+/* Outputs, one element per ray. Any pointer may be NULL to skip that field.
+ * The disk_* fields describe the first crossing inside the annulus and are
+ * NaN for rays that never cross it. */
+typedef struct {
+    int32_t *termination;
+    double *px, *py, *pz;          /* final position */
+    double *vx, *vy, *vz;          /* final unit direction of travel */
+    double *affine_length;
+    int32_t *steps;
+    int32_t *disk_crossings;       /* crossings inside the annulus */
+    double *disk_r, *disk_azimuth, *disk_g, *disk_t, *disk_lambda;
+} geodesic_results;
+
+/* Packed record layouts of the BlackHoleRayStream tool (native byte order). */
+typedef struct {
+    double origin[3];
+    double direction[3];
+} geodesic_ray_record;                  /* 48 bytes */
+
+typedef struct {
+    int32_t termination;
+    int32_t steps;
+    int32_t disk_crossings;
+    int32_t reserved;
+    double position[3];
+    double direction[3];
+    double affine_length;
+    double disk_r, disk_azimuth, disk_g, disk_t, disk_lambda;
+} geodesic_result_record;               /* 112 bytes */
+
+GEODESIC_EXPORT int geodesic_version(void);
+GEODESIC_EXPORT const char* geodesic_error_string(int code);
+GEODESIC_EXPORT double geodesic_schwarzschild_radius(double mass_kg);
+
+/* threads == 0 uses one per hardware thread. Returns NULL on failure. */
+GEODESIC_EXPORT geodesic_context* geodesic_create(unsigned threads);
+GEODESIC_EXPORT void geodesic_destroy(geodesic_context* ctx);
+GEODESIC_EXPORT unsigned geodesic_thread_count(const geodesic_context* ctx);
+
+/* Defaults of the headless tools for a black hole of radius rs, no disk. */
+GEODESIC_EXPORT void geodesic_default_params(double rs, geodesic_params* out);
+
+/* GEODESIC_OK, GEODESIC_ERROR_NULL or GEODESIC_ERROR_PARAMS, exactly as
+ * geodesic_trace_batch would judge params; lets a caller reject them before
+ * it has any rays. */
+GEODESIC_EXPORT int geodesic_check_params(const geodesic_params* params);
+
+/* Traces count rays. Per-ray problems are reported as GEODESIC_INVALID in
+ * termination; the return code only covers the arguments themselves. */
+GEODESIC_EXPORT int geodesic_trace_batch(geodesic_context* ctx, const geodesic_params* params,
+                                         size_t count, const geodesic_rays* rays,
+                                         geodesic_results* results);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* GEODESIC_API_H */
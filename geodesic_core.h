@@ -0,0 +1,260 @@
+#pragma once
+// Headless Schwarzschild null-geodesic core shared by the offline tools.
+//
+// Schwarzschild geodesics are planar, so each ray is integrated in its own
+// orbital plane as (r, dr/dλ, φ, t) with the conserved E and L, the same
+// reduction 2D_lensing.cpp uses. Positions are in meters, t is c·t in meters.
+// The accretion disk lies in the y = 0 plane like in black_hole.cpp.
+#include <glm/glm.hpp>
+#include <cmath>
+#include <algorithm>
+
+inline constexpr double SPEED_OF_LIGHT = 299792458.0;
+inline constexpr double GRAVITATIONAL_CONSTANT = 6.67430e-11;
+inline constexpr double SAGA_MASS = 8.54e36;
+inline constexpr double GEO_PI = 3.14159265358979323846;
+
+inline double schwarzschildRadius(double mass) {
+    return 2.0 * GRAVITATIONAL_CONSTANT * mass / (SPEED_OF_LIGHT * SPEED_OF_LIGHT);
+}
+
+enum class RayTermination : int {
+    Escaped  = 0,
+    Captured = 1,
+    Disk     = 2,   // stopped at the first disk crossing (only when requested)
+    MaxSteps = 3,
+};
+
+// -- Plain integration state, everything the RK4 step touches -- //
+struct GeodesicState {
+    double r;
+    double dr;    // dr/dλ
+    double phi;   // angle in the orbital plane
+    double t;     // coordinate time, c·t in meters
+};
+
+struct GeodesicRay {
+    glm::dvec3 e1, e2;   // orbital plane basis: x = r (cos φ e1 + sin φ e2)
+    glm::dvec3 normal;   // e1 × e2, direction of the angular momentum
+    double E, L;         // conserved quantities (L >= 0 by construction)
+    double rs;
+    double lambda = 0.0; // affine length travelled
+    GeodesicState s;
+};
+
+struct TraceParams {
+    double rs;
+    double escapeRadius = 0.0;      // 0 → 1000 rs
+    double stepScale    = 0.02;     // dλ = stepScale * (r - rs), clamped near the horizon
+    int    maxSteps     = 20000;
+    double diskInner    = 0.0;      // disk annulus in the y = 0 plane; inner >= outer disables it
+    double diskOuter    = 0.0;
+    bool   stopAtDisk   = true;     // terminate on the first disk crossing
+};
+
+struct DiskCrossing {
+    double r;        // radius of the crossing
+    double azimuth;  // atan2(x, z), increasing in the direction of disk rotation (about +y)
+    double g;        // observed / emitted frequency for a Keplerian emitter
+    double t;        // coordinate time delay from the observer, meters
+    double lambda;   // affine length at the crossing
+};
+
+struct GeodesicResult {
+    RayTermination termination;
+    glm::dvec3 position;   // final Cartesian position
+    glm::dvec3 direction;  // final unit direction of travel
+    double lambda;
+    int    steps;
+    int    diskCrossings;  // crossings inside [diskInner, diskOuter]
+    DiskCrossing firstDisk;
+};
+
+// Starts a ray at pos heading along dir as seen by a static observer there.
+// The local static frame gives dr/dλ = √f (d·e1), r dφ/dλ = d·e2, dt/dλ = 1/√f,
+// so observed frequencies are normalised to 1 at the observer.
+inline GeodesicRay initGeodesic(const glm::dvec3& pos, const glm::dvec3& dirIn, double rs) {
+    GeodesicRay ray;
+    glm::dvec3 dir = glm::normalize(dirIn);
+    double r = glm::length(pos);
+    ray.rs = rs;
+    ray.e1 = pos / r;
+
+    glm::dvec3 n = glm::cross(ray.e1, dir);
+    double nLen = glm::length(n);
+    if (nLen < 1e-12) {
+        // radial ray: any plane containing it works
+        glm::dvec3 helper = std::abs(ray.e1.y) < 0.9 ? glm::dvec3(0, 1, 0) : glm::dvec3(1, 0, 0);
+        n = glm::normalize(glm::cross(ray.e1, helper));
+    } else {
+        n /= nLen;
+    }
+    ray.normal = n;
+    ray.e2 = glm::cross(n, ray.e1);
+
+    double f = 1.0 - rs / r;
+    double sf = std::sqrt(std::max(f, 1e-12));
+    ray.s.r = r;
+    ray.s.dr = sf * glm::dot(dir, ray.e1);
+    ray.s.phi = 0.0;
+    ray.s.t = 0.0;
+    ray.L = r * std::max(glm::dot(dir, ray.e2), 0.0);
+    ray.E = sf;
+    return ray;
+}
+
+// The ray initGeodesic(pos, -cos α e1 + sin α e2, rs) would start, for a unit
+// e2 perpendicular to pos, without forming that direction: at small α (a
+// distant observer's shadow is ~1e-10 rad) a unit vector keeps only about
+// 16 + log10(α) digits of it, while here L = r sin α is exact.
+inline GeodesicRay initGeodesicAt(const glm::dvec3& pos, const glm::dvec3& e2, double sinA, double cosA, double rs) {
+    GeodesicRay ray;
+    double r = glm::length(pos);
+    ray.rs = rs;
+    ray.e1 = pos / r;
+    ray.e2 = e2;
+    ray.normal = glm::cross(ray.e1, ray.e2);
+    double sf = std::sqrt(std::max(1.0 - rs / r, 1e-12));
+    ray.s.r = r;
+    ray.s.dr = -sf * cosA;
+    ray.s.phi = 0.0;
+    ray.s.t = 0.0;
+    ray.L = r * std::max(sinA, 0.0);
+    ray.E = sf;
+    return ray;
+}
+
+// d/dλ of (r, dr, φ, t) using the first integrals:
+//   d²r/dλ² = L²/r³ (1 - 3rs/2r),  dφ/dλ = L/r²,  dt/dλ = E/f
+inline void geodesicRHS(const GeodesicState& s, double E, double L, double rs, GeodesicState& d) {
+    double invR = 1.0 / s.r;
+    double L2r3 = L * L * invR * invR * invR;
+    d.r = s.dr;
+    d.dr = L2r3 * (1.0 - 1.5 * rs * invR);
+    d.phi = L * invR * invR;
+    d.t = E / std::max(1.0 - rs * invR, 1e-9);
+}
+
+inline void rk4Step(GeodesicState& s, double E, double L, double rs, double h) {
+    GeodesicState k1, k2, k3, k4, tmp;
+    geodesicRHS(s, E, L, rs, k1);
+    tmp = { s.r + 0.5*h*k1.r, s.dr + 0.5*h*k1.dr, s.phi + 0.5*h*k1.phi, s.t + 0.5*h*k1.t };
+    geodesicRHS(tmp, E, L, rs, k2);
+    tmp = { s.r + 0.5*h*k2.r, s.dr + 0.5*h*k2.dr, s.phi + 0.5*h*k2.phi, s.t + 0.5*h*k2.t };
+    geodesicRHS(tmp, E, L, rs, k3);
+    tmp = { s.r + h*k3.r, s.dr + h*k3.dr, s.phi + h*k3.phi, s.t + h*k3.t };
+    geodesicRHS(tmp, E, L, rs, k4);
+
+    s.r   += (h/6.0)*(k1.r   + 2*k2.r   + 2*k3.r   + k4.r);
+    s.dr  += (h/6.0)*(k1.dr  + 2*k2.dr  + 2*k3.dr  + k4.dr);
+    s.phi += (h/6.0)*(k1.phi + 2*k2.phi + 2*k3.phi + k4.phi);
+    s.t   += (h/6.0)*(k1.t   + 2*k2.t   + 2*k3.t   + k4.t);
+}
+
+inline double adaptiveStep(double r, double rs, double stepScale) {
+    return stepScale * std::max(r - rs, 0.02 * rs);
+}
+
+inline glm::dvec3 geodesicPosition(const GeodesicRay& ray) {
+    return ray.s.r * (std::cos(ray.s.phi) * ray.e1 + std::sin(ray.s.phi) * ray.e2);
+}
+
+inline glm::dvec3 geodesicDirection(const GeodesicRay& ray) {
+    double c = std::cos(ray.s.phi), s = std::sin(ray.s.phi);
+    glm::dvec3 radial = c * ray.e1 + s * ray.e2;
+    glm::dvec3 tangential = -s * ray.e1 + c * ray.e2;
+    glm::dvec3 v = ray.s.dr * radial + (ray.L / ray.s.r) * tangential;
+    return glm::normalize(v);
+}
+
+// Frequency ratio ν_obs/ν_em for light from a prograde Keplerian emitter at r
+// (angular velocity about +y) reaching the static observer that launched the ray.
+inline double keplerianRedshift(const GeodesicRay& ray, double r) {
+    double rs = ray.rs;
+    if (r <= 1.5 * rs) return 0.0;
+    double omega = std::sqrt(rs / (2.0 * r * r * r));
+    double denom = ray.E + omega * ray.L * ray.normal.y;
+    if (denom <= 0.0) return 0.0;
+    return std::sqrt(1.0 - 1.5 * rs / r) / denom;
+}
+
+// Orbital-plane angle of the next y = 0 crossing strictly after phi.
+inline double nextPlaneCrossing(const GeodesicRay& ray, double phi) {
+    double base = std::atan2(-ray.e1.y, ray.e2.y);  // cos φ e1.y + sin φ e2.y = 0
+    double k = std::floor((phi - base) / GEO_PI) + 1.0;
+    return base + k * GEO_PI;
+}
+
+// Integrates until capture, escape, max steps or (optionally) the first disk hit.
+// visit(const GeodesicRay&) is called after every step; return false to stop.
+template <class Visitor>
+inline GeodesicResult traceGeodesic(GeodesicRay& ray, const TraceParams& p, Visitor&& visit) {
+    const double rs = p.rs;
+    const double escapeR = p.escapeRadius > 0.0 ? p.escapeRadius : 1000.0 * rs;
+    const double captureR = rs * 1.01;
+    const bool useDisk = p.diskOuter > p.diskInner;
+
+    GeodesicResult res{};
+    res.termination = RayTermination::MaxSteps;
+    double nextCross = useDisk && ray.L > 0.0 ? nextPlaneCrossing(ray, ray.s.phi) : 1e300;
+
+    int i = 0;
+    for (; i < p.maxSteps; ++i) {
+        if (ray.s.r <= captureR) { res.termination = RayTermination::Captured; break; }
+        if (ray.s.r >= escapeR && ray.s.dr > 0.0) { res.termination = RayTermination::Escaped; break; }
+
+        GeodesicState prev = ray.s;
+        double prevLambda = ray.lambda;
+        double h = adaptiveStep(ray.s.r, rs, p.stepScale);
+        rk4Step(ray.s, ray.E, ray.L, rs, h);
+        ray.lambda += h;
+
+        bool stop = false;
+        while (ray.s.phi >= nextCross) {
+            // cubic Hermite in φ for r, linear for t and λ
+            double dphi = ray.s.phi - prev.phi;
+            double w = (nextCross - prev.phi) / dphi;
+            double m0 = prev.dr * prev.r * prev.r / ray.L * dphi;
+            double m1 = ray.s.dr * ray.s.r * ray.s.r / ray.L * dphi;
+            double w2 = w * w, w3 = w2 * w;
+            double rc = (2*w3 - 3*w2 + 1) * prev.r + (w3 - 2*w2 + w) * m0
+                      + (-2*w3 + 3*w2) * ray.s.r + (w3 - w2) * m1;
+            if (rc >= p.diskInner && rc <= p.diskOuter) {
+                if (res.diskCrossings == 0) {
+                    glm::dvec3 x = rc * (std::cos(nextCross) * ray.e1 + std::sin(nextCross) * ray.e2);
+                    res.firstDisk.r = rc;
+                    res.firstDisk.azimuth = std::atan2(x.x, x.z);
+                    res.firstDisk.g = keplerianRedshift(ray, rc);
+                    res.firstDisk.t = prev.t + w * (ray.s.t - prev.t);
+                    res.firstDisk.lambda = prevLambda + w * h;
+                }
+                res.diskCrossings++;
+                if (p.stopAtDisk) { stop = true; break; }
+            }
+            nextCross += GEO_PI;
+        }
+        if (stop) { res.termination = RayTermination::Disk; ++i; break; }
+        if (!visit(static_cast<const GeodesicRay&>(ray))) { ++i; break; }
+    }
+
+    res.steps = i;
+    res.position = geodesicPosition(ray);
+    res.direction = geodesicDirection(ray);
+    res.lambda = ray.lambda;
+    return res;
+}
+
+inline GeodesicResult traceGeodesic(GeodesicRay& ray, const TraceParams& p) {
+    return traceGeodesic(ray, p, [](const GeodesicRay&) { return true; });
+}
+
+// Whether a freshly initialised ray ends in the hole, without integrating it.
+// Outside the photon sphere (1.5 rs) it must head inwards with impact
+// parameter b = L/E below the critical 3√3/2 rs; inside it, only outgoing
+// rays below it escape. Exact for Schwarzschild, so it ignores the disk.
+inline bool capturedRay(const GeodesicRay& ray) {
+    const double bCrit = 1.5 * std::sqrt(3.0) * ray.rs;
+    bool below = ray.L < bCrit * ray.E;
+    if (ray.s.r > 1.5 * ray.rs) return ray.s.dr < 0.0 && below;
+    return ray.s.dr <= 0.0 || !below;
+}
@@ -0,0 +1,225 @@
+#pragma once
+// GPU-resident n-body bodies for black_hole.cpp's --gpu-nbody mode.
+//
+// Positions (xyz, rs) and velocities live only in GPU buffers. step() runs
+// nbody.comp, whose output positions are laid out as geodesic.comp's
+// LensBodies; buildLensGrid() then runs lens_grid.comp to grid them into
+// LensGrid/LensMembers, and leaves all three bound at 5-7 for the geodesic
+// dispatch. Nothing is read back per frame, so the body count is limited by
+// the O(n^2) force pass on the GPU rather than by uploads.
+//
+// gpuNBodySelfTest() checks one step and the grid against CPU references
+// (lens_grid.h) and times the passes; it runs on any GL 4.3 driver,
+// including Mesa's llvmpipe.
+#include <GL/glew.h>
+#include <glm/glm.hpp>
+#include "lens_grid.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <iostream>
+#include <random>
+#include <vector>
+
+class GpuNBody {
+public:
+    struct Body {
+        glm::vec3 pos;    // m
+        float rs;         // Schwarzschild radius (m), i.e. 2 G m / c^2
+        glm::vec3 vel;    // m/s
+    };
+    static constexpr int GROUP = 256;   // local_size_x of both shaders
+    // Plummer softening (m) for the app and the self-test: keeps close
+    // encounters finite in float, and is small next to the cloud's 3e11-6e11 m radii.
+    static constexpr float DEFAULT_SOFTENING = 1e9f;
+
+    // Takes compiled nbody.comp and lens_grid.comp programs.
+    void init(GLuint stepProgram, GLuint gridProgram) {
+        this->stepProgram = stepProgram;
+        this->gridProgram = gridProgram;
+    }
+
+    // Replaces the bodies. The first numObjects also move the spheres in
+    // objectsBuffer (geodesic.comp's Objects block), which must already hold them.
+    void upload(const std::vector<Body>& bodies, GLuint objectsBuffer, int numObjects) {
+        n = int(bodies.size());
+        this->objectsBuffer = objectsBuffer;
+        this->numObjects = std::min(numObjects, 16);
+        std::vector<glm::vec4> pos(std::max(n, 1), glm::vec4(0.0f)), vel(std::max(n, 1), glm::vec4(0.0f));
+        for (int i = 0; i < n; ++i) {
+            pos[i] = glm::vec4(bodies[i].pos, bodies[i].rs);
+            vel[i] = glm::vec4(bodies[i].vel, 0.0f);
+        }
+        size_t bytes = pos.size() * sizeof(glm::vec4);
+        storage(posBuf[0], bytes, pos.data());
+        storage(posBuf[1], bytes, pos.data());
+        storage(velBuf, bytes, vel.data());
+        storage(membersBuf, std::max(n, 1) * sizeof(int), nullptr);
+        storage(gridBuf, sizeof(LensGrid::Block), nullptr);
+        current = 0;
+    }
+
+    // substeps symplectic Euler steps of dt seconds.
+    void step(int substeps, float dt, float softening) {
+        if (n == 0) return;
+        glUseProgram(stepProgram);
+        glUniform1i(glGetUniformLocation(stepProgram, "numBodies"), n);
+        glUniform1i(glGetUniformLocation(stepProgram, "numObjects"), objectsBuffer ? numObjects : 0);
+        glUniform1f(glGetUniformLocation(stepProgram, "dt"), dt);
+        glUniform1f(glGetUniformLocation(stepProgram, "softening2"), softening * softening);
+        glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 10, velBuf);
+        if (objectsBuffer) glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 11, objectsBuffer);
+        for (int s = 0; s < substeps; ++s) {
+            glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 8, posBuf[current]);
+            glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 9, posBuf[1 - current]);
+            glDispatchCompute(GLuint((n + GROUP - 1) / GROUP), 1, 1);
+            glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT | GL_UNIFORM_BARRIER_BIT);
+            current = 1 - current;
+        }
+    }
+
+    // Grids the current positions for the lens shader and binds LensGrid,
+    // LensBodies and LensMembers (5-7).
+    void buildLensGrid(bool enabled) {
+        glUseProgram(gridProgram);
+        glUniform1i(glGetUniformLocation(gridProgram, "numBodies"), n);
+        glUniform1i(glGetUniformLocation(gridProgram, "enabled"), enabled ? 1 : 0);
+        glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 5, gridBuf);
+        glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 6, posBuf[current]);
+        glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 7, membersBuf);
+        glDispatchCompute(1, 1, 1);
+        glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
+    }
+
+    int count() const { return n; }
+
+    // Read-backs for tests and tools, never per frame.
+    std::vector<glm::vec4> positions() const { return read<glm::vec4>(posBuf[current], n); }
+    std::vector<glm::vec4> velocities() const { return read<glm::vec4>(velBuf, n); }
+    std::vector<int> members() const { return read<int>(membersBuf, n); }
+    LensGrid::Block grid() const { return read<LensGrid::Block>(gridBuf, 1)[0]; }
+
+    // n light bodies on roughly circular orbits around a central mass of
+    // Schwarzschild radius centralRs, in a thick ring between rMin and rMax.
+    static std::vector<Body> cloud(int count, double centralRs, float rMin, float rMax, unsigned seed) {
+        std::mt19937 rng(seed);
+        std::uniform_real_distribution<float> u(0.0f, 1.0f);
+        const double gm = centralRs * 4.49377e16;   // G M = rs c^2 / 2
+        const float solarRs = 2953.25f;
+        std::vector<Body> out(count);
+        for (Body& b : out) {
+            float r = rMin + (rMax - rMin) * u(rng);
+            float phi = 6.2831853f * u(rng);
+            float y = 0.05f * r * (2.0f * u(rng) - 1.0f);
+            b.pos = glm::vec3(r * std::cos(phi), y, r * std::sin(phi));
+            float v = float(std::sqrt(gm / r));
+            b.vel = glm::vec3(-v * std::sin(phi), 0.0f, v * std::cos(phi));
+            b.rs = solarRs * (0.1f + 2.0f * u(rng));
+        }
+        return out;
+    }
+
+private:
+    static void storage(GLuint& buf, size_t bytes, const void* data) {
+        if (buf == 0) glGenBuffers(1, &buf);
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, buf);
+        glBufferData(GL_SHADER_STORAGE_BUFFER, GLsizeiptr(bytes), data, GL_DYNAMIC_COPY);
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+    }
+    template <class T>
+    static std::vector<T> read(GLuint buf, int count) {
+        std::vector<T> out(std::max(count, 0));
+        if (count <= 0) return out;
+        glMemoryBarrier(GL_BUFFER_UPDATE_BARRIER_BIT);
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, buf);
+        glGetBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, GLsizeiptr(count * sizeof(T)), out.data());
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+        return out;
+    }
+
+    GLuint stepProgram = 0, gridProgram = 0;
+    GLuint posBuf[2] = { 0, 0 };   // ping-pong, current holds the latest positions
+    GLuint velBuf = 0, membersBuf = 0, gridBuf = 0;
+    GLuint objectsBuffer = 0;
+    int n = 0, numObjects = 0, current = 0;
+};
+
+// Runs `bodies` cloud bodies around SagA through one GPU step and one GPU
+// grid build, compares them with double-precision CPU results for a sample of
+// bodies and with LensGrid::rebuild, then times `steps` more steps.
+inline bool gpuNBodySelfTest(GpuNBody& nb, int bodies, int steps, double centralRs, float softening) {
+    using Clock = std::chrono::steady_clock;
+    const float dt = 1.0f;
+    std::vector<GpuNBody::Body> init = GpuNBody::cloud(bodies, centralRs, 3e11f, 6e11f, 1234u);
+    init.push_back({ glm::vec3(0.0f), float(centralRs), glm::vec3(0.0f) });   // the central mass itself
+    const int n = int(init.size());
+    nb.upload(init, 0, 0);
+    nb.step(1, dt, softening);
+    std::vector<glm::vec4> x1 = nb.positions(), v1 = nb.velocities();
+
+    // one step in double for a spread of bodies
+    double worstAcc = 0.0, worstPos = 0.0;
+    const double eps2 = double(softening) * softening;
+    const int stride = std::max(1, n / 512);
+    for (int i = 0; i < n; i += stride) {
+        glm::dvec3 xi(init[i].pos), acc(0.0);
+        for (int j = 0; j < n; ++j) {
+            glm::dvec3 d = glm::dvec3(init[j].pos) - xi;
+            double r2 = glm::dot(d, d) + eps2;
+            if (r2 > 0.0) acc += double(init[j].rs) * 4.49377e16 * d / (r2 * std::sqrt(r2));
+        }
+        glm::dvec3 v = glm::dvec3(init[i].vel) + acc * double(dt);
+        glm::dvec3 x = xi + v * double(dt);
+        // the stored floats round to ~1.2e-7 of their magnitude; errors are what is left beyond two of those
+        glm::dvec3 dvGpu = glm::dvec3(glm::vec3(v1[i])) - glm::dvec3(init[i].vel);
+        double dvErr = glm::length(dvGpu - acc * double(dt)) - 2.4e-7 * glm::length(v);
+        worstAcc = std::max(worstAcc, dvErr / std::max(glm::length(acc) * dt, 1e-30));
+        double dxErr = glm::length(glm::dvec3(glm::vec3(x1[i])) - x) - 2.4e-7 * glm::length(x);
+        worstPos = std::max(worstPos, dxErr / (glm::length(v) * dt));
+    }
+
+    // grid against the CPU build of the same positions
+    nb.buildLensGrid(true);
+    LensGrid::Block g = nb.grid();
+    std::vector<int> members = nb.members();
+    LensGrid ref;
+    ref.rebuild(x1.data(), x1.size(), true);
+    bool gridOk = g.info == ref.block.info
+               && glm::length(glm::vec3(g.origin) - glm::vec3(ref.block.origin)) <= 1e-5f * ref.block.origin.w * LensGrid::N;
+    double worstCentroid = 0.0;
+    for (int c = 0; c < LensGrid::N * LensGrid::N * LensGrid::N && gridOk; ++c) {
+        const LensGrid::Cell &a = g.cells[c], &b = ref.block.cells[c];
+        if (a.range.x != b.range.x || a.range.y != b.range.y) { gridOk = false; break; }
+        std::vector<int> ma(members.begin() + a.range.x, members.begin() + a.range.x + a.range.y);
+        std::vector<int> mb(ref.members.begin() + b.range.x, ref.members.begin() + b.range.x + b.range.y);
+        std::sort(ma.begin(), ma.end());
+        std::sort(mb.begin(), mb.end());
+        gridOk = ma == mb;
+        if (b.centroidRs.w > 0.0f)
+            worstCentroid = std::max(worstCentroid, double(glm::length(glm::vec3(a.centroidRs) - glm::vec3(b.centroidRs))
+                                                           / ref.block.origin.w));
+    }
+    gridOk = gridOk && worstCentroid < 1e-4;
+
+    glFinish();
+    auto t0 = Clock::now();
+    nb.step(steps, dt, softening);
+    glFinish();
+    auto t1 = Clock::now();
+    nb.buildLensGrid(true);
+    glFinish();
+    auto t2 = Clock::now();
+    double stepMs = std::chrono::duration<double, std::milli>(t1 - t0).count() / std::max(steps, 1);
+    double gridMs = std::chrono::duration<double, std::milli>(t2 - t1).count();
+
+    bool ok = worstAcc < 1e-3 && worstPos < 1e-3 && gridOk;
+    std::cout << "[INFO] GPU n-body self-test, " << n << " bodies on " << glGetString(GL_RENDERER) << ":\n"
+              << "[INFO]   step vs CPU (double): max velocity-change error " << worstAcc
+              << ", position error " << worstPos << " of a step (beyond float rounding)\n"
+              << "[INFO]   lens grid vs LensGrid::rebuild: " << (gridOk ? "matches" : "DIFFERS")
+              << " (centroids within " << worstCentroid << " cells)\n"
+              << "[INFO]   " << stepMs << " ms per step (" << double(n) * n / (stepMs * 1e6) << " G interactions/s), "
+              << gridMs << " ms per grid build\n"
+              << "[INFO] Self-test " << (ok ? "passed" : "FAILED") << std::endl;
+    return ok;
+}
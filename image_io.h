@@ -0,0 +1,110 @@
+#pragma once
+// Plain image writers for the headless tools (no external image library).
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+// Portable float map, 1 (Pf) or 3 (PF) channels, rows stored bottom-up as the format requires.
+inline bool writePFM(const std::string& path, int w, int h, int channels, const float* data) {
+    if (channels != 1 && channels != 3) return false;
+    FILE* f = std::fopen(path.c_str(), "wb");
+    if (!f) return false;
+    std::fprintf(f, "%s\n%d %d\n-1.0\n", channels == 3 ? "PF" : "Pf", w, h);
+    for (int y = h - 1; y >= 0; --y)
+        std::fwrite(data + size_t(y) * w * channels, sizeof(float), size_t(w) * channels, f);
+    return std::fclose(f) == 0;
+}
+
+// Binary 8-bit RGB, rows top-down.
+inline bool writePPM(const std::string& path, int w, int h, const unsigned char* rgb) {
+    FILE* f = std::fopen(path.c_str(), "wb");
+    if (!f) return false;
+    std::fprintf(f, "P6\n%d %d\n255\n", w, h);
+    std::fwrite(rgb, 1, size_t(w) * h * 3, f);
+    return std::fclose(f) == 0;
+}
+
+// -- Minimal little-endian baseline TIFF writer -- //
+struct TiffEntry { uint16_t tag, type; uint32_t count, value; };
+
+inline void tiffPut16(std::vector<unsigned char>& b, uint16_t v) { b.push_back(v & 0xff); b.push_back(v >> 8); }
+inline void tiffPut32(std::vector<unsigned char>& b, uint32_t v) { for (int i = 0; i < 4; ++i) b.push_back((v >> (8*i)) & 0xff); }
+
+// Writes the IFD for `entries` at the end of the file; entries must be sorted by tag.
+inline bool tiffWriteIFD(FILE* f, std::vector<TiffEntry> entries) {
+    long ifdPos = std::ftell(f);
+    if (ifdPos & 1) { std::fputc(0, f); ++ifdPos; }
+    std::vector<unsigned char> b;
+    tiffPut16(b, uint16_t(entries.size()));
+    for (const auto& e : entries) {
+        tiffPut16(b, e.tag); tiffPut16(b, e.type); tiffPut32(b, e.count);
+        if (e.type == 3 && e.count == 1) { tiffPut16(b, uint16_t(e.value)); tiffPut16(b, 0); }
+        else tiffPut32(b, e.value);
+    }
+    tiffPut32(b, 0);   // no further IFDs
+    std::fwrite(b.data(), 1, b.size(), f);
+    // patch the header's first-IFD offset
+    std::fseek(f, 4, SEEK_SET);
+    uint32_t off = uint32_t(ifdPos);
+    unsigned char o[4] = { (unsigned char)(off), (unsigned char)(off >> 8), (unsigned char)(off >> 16), (unsigned char)(off >> 24) };
+    std::fwrite(o, 1, 4, f);
+    return true;
+}
+
+// Appends `count` SHORTs to the file and returns their offset (for tags with count > 2).
+inline uint32_t tiffWriteShorts(FILE* f, uint16_t value, uint32_t count) {
+    long pos = std::ftell(f);
+    if (pos & 1) { std::fputc(0, f); ++pos; }
+    std::vector<unsigned char> b;
+    for (uint32_t i = 0; i < count; ++i) tiffPut16(b, value);
+    std::fwrite(b.data(), 1, b.size(), f);
+    return uint32_t(pos);
+}
+
+// Multi-channel 32-bit float image, channels interleaved, rows top-down.
+// Channel names go into ImageDescription so readers can tell the bands apart.
+inline bool writeTiffFloat(const std::string& path, int w, int h, int channels,
+                           const float* data, const std::string& description = "") {
+    FILE* f = std::fopen(path.c_str(), "wb");
+    if (!f) return false;
+    const unsigned char header[8] = { 'I', 'I', 42, 0, 0, 0, 0, 0 };
+    std::fwrite(header, 1, 8, f);
+
+    uint32_t dataOff = 8;
+    uint32_t dataBytes = uint32_t(size_t(w) * h * channels * sizeof(float));
+    std::fwrite(data, sizeof(float), size_t(w) * h * channels, f);
+
+    uint32_t descOff = 0;
+    if (!description.empty()) {
+        descOff = uint32_t(std::ftell(f));
+        std::fwrite(description.c_str(), 1, description.size() + 1, f);
+    }
+    uint32_t bpsOff = channels > 2 ? tiffWriteShorts(f, 32, channels) : 0;
+    uint32_t fmtOff = channels > 2 ? tiffWriteShorts(f, 3, channels) : 0;
+    uint32_t extraOff = channels - 1 > 2 ? tiffWriteShorts(f, 0, channels - 1) : 0;
+    auto shorts = [&](uint32_t off, uint16_t v, uint32_t n) {
+        return n > 2 ? off : (n == 2 ? uint32_t(v) | (uint32_t(v) << 16) : uint32_t(v));
+    };
+
+    std::vector<TiffEntry> e = {
+        { 256, 4, 1, uint32_t(w) },                            // ImageWidth
+        { 257, 4, 1, uint32_t(h) },                            // ImageLength
+        { 258, 3, uint32_t(channels), shorts(bpsOff, 32, channels) },   // BitsPerSample
+        { 259, 3, 1, 1 },                                      // Compression: none
+        { 262, 3, 1, channels == 3 ? 2u : 1u },                // Photometric: RGB or MinIsBlack
+    };
+    if (descOff) e.push_back({ 270, 2, uint32_t(description.size() + 1), descOff });   // ImageDescription
+    e.push_back({ 273, 4, 1, dataOff });                       // StripOffsets
+    e.push_back({ 277, 3, 1, uint32_t(channels) });            // SamplesPerPixel
+    e.push_back({ 278, 4, 1, uint32_t(h) });                   // RowsPerStrip
+    e.push_back({ 279, 4, 1, dataBytes });                     // StripByteCounts
+    e.push_back({ 284, 3, 1, 1 });                             // PlanarConfiguration: chunky
+    if (channels != 1 && channels != 3)
+        e.push_back({ 338, 3, uint32_t(channels - 1), shorts(extraOff, 0, channels - 1) });   // ExtraSamples
+    e.push_back({ 339, 3, uint32_t(channels), shorts(fmtOff, 3, channels) });   // SampleFormat: IEEE float
+
+    std::fseek(f, 0, SEEK_END);
+    tiffWriteIFD(f, e);
+    return std::fclose(f) == 0;
+}
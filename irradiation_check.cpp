@@ -0,0 +1,47 @@
+// Headless check of the disk self-irradiation (disk_irradiation.h).
+//
+// Builds the emission tables and transfer matrix for a disk, pushes the
+// disk's own flux through it and checks that every bin of both the flux and
+// the returning radiation is finite and non-negative. Exits non-zero on
+// failure, so it runs as a CTest test:
+//
+//   BlackHoleIrradiationCheck [--r-in 2.2 --r-out 5.2 --t-max 1.5e4 --bounces 2 --efficiency 0.5]
+//
+// Radii are in Schwarzschild radii of SagA; the defaults are BlackHole3D's disk.
+#include "disk_irradiation.h"
+#include "cli_args.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <vector>
+using namespace std;
+
+int main(int argc, char** argv) {
+    CliArgs args(argc, argv);
+    const double rs = 2.0 * GRAVITATIONAL_CONSTANT * SAGA_MASS / (SPEED_OF_LIGHT * SPEED_OF_LIGHT);
+    double rIn = args.num("r-in", 2.2) * rs, rOut = args.num("r-out", 5.2) * rs;
+    double tMax = args.num("t-max", 1.5e4);
+    int bounces = int(args.integer("bounces", 2));
+    float efficiency = float(args.num("efficiency", 0.5));
+
+    EmissionTables tables = EmissionTables::build(rIn, rOut, rs, tMax);
+    DiskIrradiation m = DiskIrradiation::build(rIn, rOut, rs);
+    vector<float> F(DiskIrradiation::BINS), irr;
+    m.binFlux(tables, F.data());
+    m.illuminate(F.data(), bounces, efficiency, irr);
+
+    float lo = 1e30f, hi = -1e30f;
+    int bad = 0;
+    for (int i = 0; i < DiskIrradiation::BINS; ++i) {
+        if (!std::isfinite(F[i]) || F[i] < 0.0f || !std::isfinite(irr[i]) || irr[i] < 0.0f) {
+            if (bad++ < 8)
+                printf("[FAIL] bin %d at %.3f rs: flux %g, irradiation %g\n", i, m.binRadius(i) / rs, F[i], irr[i]);
+            continue;
+        }
+        lo = min(lo, irr[i]);
+        hi = max(hi, irr[i]);
+    }
+    printf("[%s] Irradiation of the %.2f-%.2f rs disk: %d bins in [%g, %g], %d bad\n", bad ? "FAIL" : "PASS",
+           rIn / rs, rOut / rs, DiskIrradiation::BINS, lo, hi, bad);
+    return bad ? 1 : 0;
+}
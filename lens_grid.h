@@ -0,0 +1,84 @@
+#pragma once
+// Uniform grid over the lensing masses for the multi-lens mode of geodesic.comp.
+//
+// Each cell keeps its members and a merged monopole (rs-weighted centroid,
+// summed rs). The shader sums members of the ray's own and adjacent cells
+// exactly and every farther cell as its monopole, so per-step cost is bounded
+// by the cell count rather than the number of lenses. Layouts mirror the
+// std430 blocks LensGrid (binding 5), LensBodies (6) and LensMembers (7).
+#include "frame_arena.h"
+#include <glm/glm.hpp>
+#include <algorithm>
+#include <vector>
+
+struct LensGrid {
+    static constexpr int N = 4;   // cells per axis
+
+    struct Cell {
+        glm::vec4 centroidRs = glm::vec4(0.0f);   // xyz centroid, w summed rs
+        glm::ivec4 range = glm::ivec4(0);         // x first member, y member count
+    };
+    struct Block {
+        glm::vec4 origin = glm::vec4(0.0f);   // xyz min corner, w cell size
+        glm::ivec4 info = glm::ivec4(0);      // x cells per axis, y lens count, z enabled
+        Cell cells[N * N * N];
+    };
+
+    Block block;
+    std::vector<glm::vec4> bodies;   // xyz position, w rs
+    std::vector<int> members;        // body indices grouped by cell
+
+    int cellIndex(const glm::vec3& p) const {
+        glm::ivec3 c = glm::ivec3(glm::floor((p - glm::vec3(block.origin)) / block.origin.w));
+        c = glm::clamp(c, glm::ivec3(0), glm::ivec3(N - 1));
+        return c.x + N * (c.y + N * c.z);
+    }
+
+    static LensGrid build(const std::vector<glm::vec4>& posRs, bool enabled) {
+        LensGrid g;
+        g.rebuild(posRs.data(), posRs.size(), enabled);
+        return g;
+    }
+
+    // Rebuilds in place for a per-frame update: bodies and members keep their
+    // capacity and the temporaries live in the frame arena.
+    void rebuild(const glm::vec4* posRs, size_t n, bool enabled) {
+        block = Block();
+        bodies.assign(posRs, posRs + n);
+        block.info = glm::ivec4(N, int(n), enabled ? 1 : 0, 0);
+        if (n == 0) { block.origin.w = 1.0f; members.clear(); return; }
+
+        glm::vec3 lo(posRs[0]), hi(posRs[0]);
+        for (size_t i = 0; i < n; ++i) {
+            lo = glm::min(lo, glm::vec3(posRs[i]));
+            hi = glm::max(hi, glm::vec3(posRs[i]));
+        }
+        float side = std::max(std::max(hi.x - lo.x, hi.y - lo.y), hi.z - lo.z);
+        side = std::max(side * 1.02f, 1.0f);   // keep the far faces inside the last cell
+        glm::vec3 centre = 0.5f * (lo + hi);
+        block.origin = glm::vec4(centre - 0.5f * side, side / N);
+
+        FrameArena::Scope scratch(threadFrameArena());
+        FrameVector<int> cellOf(n);
+        FrameVector<int> count(N * N * N, 0);
+        for (size_t i = 0; i < n; ++i) {
+            cellOf[i] = cellIndex(glm::vec3(posRs[i]));
+            count[cellOf[i]]++;
+        }
+        int start = 0;
+        for (int c = 0; c < N * N * N; ++c) {
+            block.cells[c].range = glm::ivec4(start, 0, 0, 0);
+            start += count[c];
+        }
+        members.assign(n, 0);
+        for (size_t i = 0; i < n; ++i) {
+            Cell& cell = block.cells[cellOf[i]];
+            members[cell.range.x + cell.range.y++] = int(i);
+            float rs = posRs[i].w;
+            cell.centroidRs += glm::vec4(glm::vec3(posRs[i]) * rs, rs);
+        }
+        for (Cell& cell : block.cells)
+            if (cell.centroidRs.w > 0.0f)
+                cell.centroidRs = glm::vec4(glm::vec3(cell.centroidRs) / cell.centroidRs.w, cell.centroidRs.w);
+    }
+};
@@ -0,0 +1,64 @@
+#pragma once
+// Thread-safe least-recently-used cache with a byte budget.
+//
+// Values are shared_ptr<const V>, so a reader keeps its entry alive even if
+// it is evicted while in use. Keys need operator== and a hasher.
+#include <cstddef>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+
+template <class Key, class Value, class Hash = std::hash<Key>>
+class LruCache {
+public:
+    using Ptr = std::shared_ptr<const Value>;
+
+    explicit LruCache(size_t budgetBytes) : budget(budgetBytes) {}
+
+    Ptr get(const Key& key) {
+        std::lock_guard<std::mutex> lock(mtx);
+        auto it = index.find(key);
+        if (it == index.end()) { misses++; return nullptr; }
+        entries.splice(entries.begin(), entries, it->second);
+        hits++;
+        return it->second->value;
+    }
+
+    // Inserts or replaces key; entries larger than the whole budget are not kept.
+    void put(const Key& key, Ptr value, size_t bytes) {
+        std::lock_guard<std::mutex> lock(mtx);
+        auto it = index.find(key);
+        if (it != index.end()) {
+            used -= it->second->bytes;
+            entries.erase(it->second);
+            index.erase(it);
+        }
+        if (bytes > budget) return;
+        entries.push_front(Entry{ key, std::move(value), bytes });
+        index[key] = entries.begin();
+        used += bytes;
+        while (used > budget) {
+            used -= entries.back().bytes;
+            index.erase(entries.back().key);
+            entries.pop_back();
+        }
+    }
+
+    struct Stats { size_t entries, bytes, hits, misses; };
+    Stats stats() {
+        std::lock_guard<std::mutex> lock(mtx);
+        return Stats{ entries.size(), used, hits, misses };
+    }
+
+private:
+    struct Entry {
+        Key key;
+        Ptr value;
+        size_t bytes;
+    };
+    size_t budget, used = 0, hits = 0, misses = 0;
+    std::mutex mtx;
+    std::list<Entry> entries;   // most recent first
+    std::unordered_map<Key, typename std::list<Entry>::iterator, Hash> index;
+};
@@ -0,0 +1,73 @@
+#pragma once
+// Headless observer/camera basis, built the same way as black_hole.cpp's
+// Camera::position() and Engine::uploadCameraUBO() so offline tools see the
+// scene exactly like the interactive view.
+#include "geodesic_core.h"
+#include <glm/glm.hpp>
+#include <cmath>
+
+struct ObserverView {
+    glm::dvec3 pos;
+    glm::dvec3 right, up, forward;
+    double tanHalfFov = 0.0;
+    double aspect = 1.0;
+
+    // elevation is measured from +y (the disk normal), so it doubles as the inclination.
+    static ObserverView orbit(double radius, double azimuth, double elevation,
+                              double fovYDegrees, double aspect,
+                              const glm::dvec3& target = glm::dvec3(0.0)) {
+        ObserverView v;
+        double el = std::clamp(elevation, 0.01, GEO_PI - 0.01);
+        v.pos = target + glm::dvec3(radius * std::sin(el) * std::cos(azimuth),
+                                    radius * std::cos(el),
+                                    radius * std::sin(el) * std::sin(azimuth));
+        v.forward = glm::normalize(target - v.pos);
+        v.right = glm::normalize(glm::cross(v.forward, glm::dvec3(0, 1, 0)));
+        v.up = glm::cross(v.right, v.forward);
+        v.tanHalfFov = std::tan(fovYDegrees * GEO_PI / 180.0 * 0.5);
+        v.aspect = aspect;
+        return v;
+    }
+
+    // Direction through tangent-plane coordinates (tu, tv), i.e. u/v already scaled by tanHalfFov.
+    glm::dvec3 tangentDir(double tu, double tv) const {
+        return glm::normalize(tu * right + tv * up + forward);
+    }
+
+    // Direction through pixel (x, y) of a W×H image, y down like the compute shader.
+    glm::dvec3 pixelDir(double x, double y, int W, int H) const {
+        double u = (2.0 * (x + 0.5) / W - 1.0) * aspect * tanHalfFov;
+        double v = (1.0 - 2.0 * (y + 0.5) / H) * tanHalfFov;
+        return tangentDir(u, v);
+    }
+
+    // Free look from the same position: yaw about up, then pitch about right,
+    // then roll about forward (radians; positive yaw turns right, pitch up).
+    ObserverView rotated(double yaw, double pitch, double roll) const {
+        auto turn = [](glm::dvec3& a, glm::dvec3& b, double angle) {   // rotates a towards b
+            glm::dvec3 a2 = std::cos(angle) * a + std::sin(angle) * b;
+            b = std::cos(angle) * b - std::sin(angle) * a;
+            a = a2;
+        };
+        ObserverView v = *this;
+        turn(v.forward, v.right, yaw);
+        turn(v.forward, v.up, pitch);
+        turn(v.up, v.right, roll);
+        return v;
+    }
+};
+
+// Relativistic aberration for an observer moving with velocity beta (units of
+// c) through the static observer at the same point. Returns the static-frame
+// direction of the moving observer's view direction d (unit vectors, both
+// pointing from the eye towards the source) and sets doppler to ν_moving /
+// ν_static for light arriving from it; disk samples then carry g · doppler.
+inline glm::dvec3 aberrate(const glm::dvec3& d, const glm::dvec3& beta, double& doppler) {
+    double b2 = glm::dot(beta, beta);
+    if (b2 <= 0.0) { doppler = 1.0; return d; }
+    double gamma = 1.0 / std::sqrt(1.0 - b2);
+    double bd = glm::dot(beta, d);
+    doppler = 1.0 / (gamma * (1.0 - bd));
+    glm::dvec3 s = d - gamma * beta + (gamma - 1.0) * (bd / b2) * beta;
+    return glm::normalize(s);
+}
@@ -0,0 +1,124 @@
+#pragma once
+// Small shared worker pool for the CPU tools.
+//
+// parallelFor hands out [begin, end) in chunks of `grain` and calls
+// fn(chunkBegin, chunkEnd, slot), where slot < pool.size() identifies the
+// executor so callers can keep per-slot accumulators and reduce them after.
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+class ThreadPool {
+public:
+    // Throws std::system_error if a worker thread cannot be started, after
+    // joining the ones that were.
+    explicit ThreadPool(unsigned threads = 0) {
+        if (threads == 0) threads = std::max(1u, std::thread::hardware_concurrency());
+        try {
+            for (unsigned i = 0; i < threads; ++i)
+                workers.emplace_back([this] { workerLoop(); });
+        } catch (...) {
+            stop();
+            throw;
+        }
+    }
+    ~ThreadPool() { stop(); }
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    unsigned size() const { return unsigned(workers.size()); }
+
+    void submit(std::function<void()> task) {
+        {
+            std::lock_guard<std::mutex> lock(mtx);
+            tasks.push_back(std::move(task));
+        }
+        cv.notify_one();
+    }
+
+    template <class Fn>
+    void parallelFor(size_t begin, size_t end, size_t grain, Fn&& fn) {
+        if (end <= begin) return;
+        if (grain == 0) grain = 1;
+        size_t chunks = (end - begin + grain - 1) / grain;
+        unsigned slots = unsigned(std::min<size_t>(chunks, size()));
+
+        std::atomic<size_t> next{begin};
+        std::atomic<unsigned> pending{slots};
+        auto runSlot = [&](unsigned slot) {
+            for (;;) {
+                size_t i0 = next.fetch_add(grain);
+                if (i0 >= end) break;
+                fn(i0, std::min(end, i0 + grain), slot);
+            }
+            if (pending.fetch_sub(1) == 1) {
+                std::lock_guard<std::mutex> lock(mtx);
+                doneCv.notify_all();
+            }
+        };
+        for (unsigned s = 1; s < slots; ++s)
+            submit([&runSlot, s] { runSlot(s); });
+        runSlot(0);
+        waitHelping([&] { return pending.load() == 0; });
+    }
+
+private:
+    // Runs queued tasks while waiting so nested parallelFor calls cannot starve.
+    template <class Pred>
+    void waitHelping(Pred done) {
+        while (!done()) {
+            std::function<void()> task;
+            {
+                std::unique_lock<std::mutex> lock(mtx);
+                if (tasks.empty()) {
+                    doneCv.wait(lock, [&] { return done() || !tasks.empty(); });
+                    if (done()) return;
+                }
+                task = std::move(tasks.front());
+                tasks.pop_front();
+            }
+            task();
+        }
+    }
+
+    void workerLoop() {
+        for (;;) {
+            std::function<void()> task;
+            {
+                std::unique_lock<std::mutex> lock(mtx);
+                cv.wait(lock, [&] { return stopping || !tasks.empty(); });
+                if (stopping && tasks.empty()) return;
+                task = std::move(tasks.front());
+                tasks.pop_front();
+            }
+            task();
+        }
+    }
+
+    void stop() {
+        {
+            std::lock_guard<std::mutex> lock(mtx);
+            stopping = true;
+        }
+        cv.notify_all();
+        for (auto& w : workers) w.join();
+    }
+
+    std::vector<std::thread> workers;
+    std::deque<std::function<void()>> tasks;
+    std::mutex mtx;
+    std::condition_variable cv;
+    std::condition_variable doneCv;
+    bool stopping = false;
+};
+
+inline ThreadPool& defaultPool() {
+    static ThreadPool pool;
+    return pool;
+}
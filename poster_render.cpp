@@ -0,0 +1,189 @@
+// Out-of-core still renderer for poster-sized images, streamed to a tiled TIFF.
+//
+//   BlackHolePoster --width 50000 --height 50000 --out poster.tif --distance 20 --inclination 80
+//
+// The image is rendered one band of tiles at a time and every finished tile
+// goes straight to the TIFF writer thread, so memory is a few bands wide and
+// never the whole image. Each band is also box-filtered into the next level
+// of a multi-resolution pyramid stored in the same file (--levels 1 keeps
+// only full resolution). --float writes linear 32-bit float RGB instead of
+// tone-mapped 8-bit.
+//
+// Geometry comes from one deflection table for the camera radius, built
+// once (or loaded from --deflection-cache) and shared by every tile, and
+// shading from one set of emission tables; --trace integrates every pixel
+// instead. Distances and disk radii are in Schwarzschild radii as in
+// BlackHoleRender.
+#include "geodesic_core.h"
+#include "observer.h"
+#include "gbuffer.h"
+#include "deflection_table.h"
+#include "emission_tables.h"
+#include "disk_shading.h"
+#include "tiled_tiff.h"
+#include "parallel.h"
+#include "cli_args.h"
+#include <chrono>
+#include <cstring>
+#include <functional>
+#include <iostream>
+#include <string>
+#include <vector>
+using namespace std;
+using Clock = std::chrono::high_resolution_clock;
+
+// One tile row of a reduced level, accumulated from the level above it.
+struct PyramidBand {
+    uint32_t width = 0;
+    vector<float> sum;     // rgb + weight per pixel, tile rows × width
+    void reset(uint32_t w, uint32_t tile) {
+        width = w;
+        sum.assign(size_t(w) * tile * 4, 0.0f);
+    }
+    void add(uint32_t x, uint32_t row, const glm::vec3& c) {
+        float* p = &sum[(size_t(row) * width + x) * 4];
+        p[0] += c.r; p[1] += c.g; p[2] += c.b; p[3] += 1.0f;
+    }
+    glm::vec3 at(uint32_t x, uint32_t row) const {
+        const float* p = &sum[(size_t(row) * width + x) * 4];
+        return p[3] > 0.0f ? glm::vec3(p[0], p[1], p[2]) / p[3] : glm::vec3(0.0f);
+    }
+};
+
+int main(int argc, char** argv) {
+    CliArgs args(argc, argv);
+    const double rs = schwarzschildRadius(args.num("mass", SAGA_MASS));
+    const uint32_t W = uint32_t(args.integer("width", 16384));
+    const uint32_t H = uint32_t(args.integer("height", 16384));
+    const uint32_t T = uint32_t(std::max<long long>(16, args.integer("tile", 256))) / 16 * 16;
+    const bool floatOut = args.has("float");
+    const double rIn  = args.num("r-in", 2.2) * rs;
+    const double rOut = args.num("r-out", 5.2) * rs;
+    const string out = args.str("out", "poster.tif");
+
+    EmissionTables tables;
+    string tablePath = args.str("emission-tables", "");
+    if (tablePath.empty() || !tables.load(tablePath))
+        tables = EmissionTables::build(rIn, rOut, rs, args.num("t-max", 1.5e4));
+    ShadeParams sp;
+    sp.exposure = args.num("exposure", 1.5);
+
+    const double distance = args.num("distance", 20.0);
+    ObserverView view = ObserverView::orbit(distance * rs, args.num("azimuth", 0.0),
+                                            args.num("inclination", 80.0) * GEO_PI / 180.0,
+                                            args.num("fov", 60.0), double(W) / H);
+    TraceParams tp;
+    tp.rs = rs;
+    tp.escapeRadius = std::max(2.0 * double(tables.rOut), 1.01 * glm::length(view.pos));
+    tp.stepScale = args.num("step", 0.02);
+    tp.diskInner = tables.rIn;
+    tp.diskOuter = tables.rOut;
+    tp.stopAtDisk = true;
+
+    auto t0 = Clock::now();
+    const bool exact = args.has("trace");
+    DeflectionTable table;
+    if (!exact) {
+        string cachePath = args.str("deflection-cache", "");
+        double escapeRs = tp.escapeRadius / rs;
+        if (cachePath.empty() || !table.load(cachePath) || !table.matches(distance, escapeRs)) {
+            table = DeflectionTable::build(distance, escapeRs, int(args.integer("table-rays", 2048)),
+                                           int(args.integer("table-phi", 2048)));
+            if (!cachePath.empty() && !table.save(cachePath))
+                cerr << "[WARN] Could not write deflection cache " << cachePath << "\n";
+        }
+    }
+
+    // pyramid levels halve until the image fits in one tile
+    vector<TiffLevel> levels{ { W, H } };
+    const size_t maxLevels = size_t(std::max<long long>(1, args.integer("levels", 32)));
+    while (levels.size() < maxLevels && std::max(levels.back().width, levels.back().height) > T)
+        levels.push_back({ (levels.back().width + 1) / 2, (levels.back().height + 1) / 2 });
+
+    string desc = "Schwarzschild black hole, " + to_string(W) + "x" + to_string(H)
+                + (floatOut ? ", linear float RGB" : ", clamped 8-bit RGB");
+    TiledTiffWriter tiff(out, levels, T, 3, floatOut, desc, args.has("bigtiff"));
+    if (!tiff.ok()) {
+        cerr << "Cannot write " << out << "\n";
+        return EXIT_FAILURE;
+    }
+
+    // Packs rows of colors into one padded tile for the writer.
+    auto emit = [&](int level, uint32_t tx, uint32_t ty, const vector<glm::vec3>& colors) {
+        vector<unsigned char> data(tiff.tileBytes(), 0);
+        for (size_t i = 0; i < colors.size(); ++i) {
+            if (floatOut) memcpy(&data[i * 12], &colors[i], 12);
+            else storeRGB8(colors[i], &data[i * 3]);
+        }
+        tiff.write(level, tx, ty, std::move(data));
+    };
+
+    ThreadPool& pool = defaultPool();
+    vector<PyramidBand> bands(levels.size());
+    for (size_t l = 1; l < levels.size(); ++l) bands[l].reset(levels[l].width, T);
+    vector<vector<glm::vec3>> slotColors(pool.size(), vector<glm::vec3>(size_t(T) * T));
+
+    // Folds a finished tile of level l (colors at tile-local rows) into level l + 1's band.
+    auto reduce = [&](size_t l, uint32_t x0, uint32_t y0, uint32_t tw, uint32_t th, const vector<glm::vec3>& c) {
+        if (l + 1 >= levels.size()) return;
+        for (uint32_t y = 0; y < th; ++y)
+            for (uint32_t x = 0; x < tw; ++x)
+                bands[l + 1].add((x0 + x) / 2, ((y0 + y) / 2) % T, c[size_t(y) * T + x]);
+    };
+
+    // Emits band ty of reduced level l, folds it into l + 1 and cascades when that band fills.
+    function<void(size_t, uint32_t)> flushBand = [&](size_t l, uint32_t ty) {
+        const TiffLevel& lv = levels[l];
+        pool.parallelFor(0, tiff.tilesAcross(int(l)), 1, [&](size_t tx0, size_t tx1, unsigned slot) {
+            vector<glm::vec3>& colors = slotColors[slot];
+            for (size_t tx = tx0; tx < tx1; ++tx) {
+                uint32_t x0 = uint32_t(tx) * T, y0 = ty * T;
+                uint32_t tw = std::min(T, lv.width - x0), th = std::min(T, lv.height - y0);
+                std::fill(colors.begin(), colors.end(), glm::vec3(0.0f));
+                for (uint32_t y = 0; y < th; ++y)
+                    for (uint32_t x = 0; x < tw; ++x)
+                        colors[size_t(y) * T + x] = bands[l].at(x0 + x, y);
+                emit(int(l), uint32_t(tx), ty, colors);
+                reduce(l, x0, y0, tw, th, colors);
+            }
+        });
+        bands[l].reset(lv.width, T);
+        if (l + 1 < levels.size() && (ty % 2 == 1 || ty + 1 == tiff.tilesDown(int(l))))
+            flushBand(l + 1, ty / 2);
+    };
+
+    uint64_t tilesDone = 0;
+    const uint32_t across = tiff.tilesAcross(0), down = tiff.tilesDown(0);
+    for (uint32_t ty = 0; ty < down; ++ty) {
+        pool.parallelFor(0, across, 1, [&](size_t tx0, size_t tx1, unsigned slot) {
+            vector<glm::vec3>& colors = slotColors[slot];
+            for (size_t tx = tx0; tx < tx1; ++tx) {
+                uint32_t x0 = uint32_t(tx) * T, y0 = ty * T;
+                uint32_t tw = std::min(T, W - x0), th = std::min(T, H - y0);
+                std::fill(colors.begin(), colors.end(), glm::vec3(0.0f));
+                for (uint32_t y = 0; y < th; ++y)
+                    for (uint32_t x = 0; x < tw; ++x) {
+                        glm::dvec3 dir = view.pixelDir(double(x0 + x), double(y0 + y), int(W), int(H));
+                        GSample s = exact ? traceSample(view, dir, tp)
+                                  : table.sample(view.pos, dir, rs, tp.diskInner, tp.diskOuter);
+                        colors[size_t(y) * T + x] = shadeSample(s, tables, sp);
+                    }
+                emit(0, uint32_t(tx), ty, colors);
+                reduce(0, x0, y0, tw, th, colors);
+            }
+        });
+        tilesDone += across;
+        if (levels.size() > 1 && (ty % 2 == 1 || ty + 1 == down)) flushBand(1, ty / 2);
+        if (ty % 16 == 15 || ty + 1 == down)
+            cout << "[INFO] " << ty + 1 << "/" << down << " tile rows, "
+                 << tiff.bytesWritten / (1 << 20) << " MiB written" << endl;
+    }
+    if (!tiff.close()) {
+        cerr << "Failed writing " << out << "\n";
+        return EXIT_FAILURE;
+    }
+    double secs = chrono::duration<double>(Clock::now() - t0).count();
+    cout << "[INFO] Rendered " << W << "x" << H << " (" << tilesDone << " tiles, " << levels.size()
+         << " levels) in " << secs << " s, written to " << out << (tiff.bigTiff() ? " (BigTIFF)" : "") << "\n";
+    return 0;
+}
@@ -0,0 +1,273 @@
+// Streaming ray tracer for pipelines: packed ray records in, packed results out.
+//
+//   generate_rays | BlackHoleRayStream --disk-inner 2.2 --disk-outer 10 > results.bin
+//   BlackHoleRayStream --in rays.bin --out results.bin --chunk 262144
+//
+// Input is a stream of geodesic_ray_record, output the matching stream of
+// geodesic_result_record, in input order (both in geodesic_api.h). A file
+// given with --in is memory-mapped and pages already consumed are released,
+// so inputs far larger than RAM stream through a fixed footprint: --buffers
+// chunks of --chunk rays, reading, tracing and writing concurrently. Radii on
+// the command line are in Schwarzschild radii; record coordinates are meters.
+// Traces through libgeodesic. POSIX only.
+#include "geodesic_api.h"
+#include "cli_args.h"
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <chrono>
+#include <condition_variable>
+#include <cstdio>
+#include <cstring>
+#include <deque>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+using namespace std;
+using Clock = std::chrono::high_resolution_clock;
+
+static_assert(sizeof(geodesic_ray_record) == 48, "ray record layout");
+static_assert(sizeof(geodesic_result_record) == 112, "result record layout");
+
+// One chunk of rays in the SoA layout libgeodesic traces.
+struct RayChunk {
+    size_t count = 0;
+    bool last = false;
+    vector<double> in[6];        // ox oy oz dx dy dz
+    vector<double> out[12];      // px py pz vx vy vz affine r azimuth g t lambda
+    vector<int32_t> term, steps, crossings;
+
+    explicit RayChunk(size_t capacity) {
+        for (auto& v : in) v.resize(capacity);
+        for (auto& v : out) v.resize(capacity);
+        term.resize(capacity);
+        steps.resize(capacity);
+        crossings.resize(capacity);
+    }
+    void load(const geodesic_ray_record* recs, size_t n) {
+        count = n;
+        for (size_t i = 0; i < n; ++i)
+            for (int k = 0; k < 3; ++k) {
+                in[k][i] = recs[i].origin[k];
+                in[3 + k][i] = recs[i].direction[k];
+            }
+    }
+    geodesic_rays rays() const {
+        return { in[0].data(), in[1].data(), in[2].data(), in[3].data(), in[4].data(), in[5].data() };
+    }
+    geodesic_results results() {
+        geodesic_results r;
+        r.termination = term.data();
+        r.px = out[0].data(); r.py = out[1].data(); r.pz = out[2].data();
+        r.vx = out[3].data(); r.vy = out[4].data(); r.vz = out[5].data();
+        r.affine_length = out[6].data();
+        r.steps = steps.data();
+        r.disk_crossings = crossings.data();
+        r.disk_r = out[7].data(); r.disk_azimuth = out[8].data(); r.disk_g = out[9].data();
+        r.disk_t = out[10].data(); r.disk_lambda = out[11].data();
+        return r;
+    }
+    void pack(geodesic_result_record* recs) const {
+        for (size_t i = 0; i < count; ++i) {
+            geodesic_result_record& o = recs[i];
+            o.termination = term[i];
+            o.steps = steps[i];
+            o.disk_crossings = crossings[i];
+            o.reserved = 0;
+            for (int k = 0; k < 3; ++k) {
+                o.position[k] = out[k][i];
+                o.direction[k] = out[3 + k][i];
+            }
+            o.affine_length = out[6][i];
+            o.disk_r = out[7][i]; o.disk_azimuth = out[8][i]; o.disk_g = out[9][i];
+            o.disk_t = out[10][i]; o.disk_lambda = out[11][i];
+        }
+    }
+};
+
+// Blocking FIFO handing chunks between the reader, tracer and writer stages.
+class ChunkQueue {
+public:
+    void push(RayChunk* c) {
+        { lock_guard<mutex> lock(mtx); items.push_back(c); }
+        cv.notify_one();
+    }
+    RayChunk* pop() {
+        unique_lock<mutex> lock(mtx);
+        cv.wait(lock, [&] { return !items.empty(); });
+        RayChunk* c = items.front();
+        items.pop_front();
+        return c;
+    }
+private:
+    mutex mtx;
+    condition_variable cv;
+    deque<RayChunk*> items;
+};
+
+// Record source: a memory-mapped file, or stdin read in chunk-sized blocks.
+class RaySource {
+public:
+    bool open(const string& path) {
+        if (path.empty() || path == "-") return true;
+        fd = ::open(path.c_str(), O_RDONLY);
+        struct stat st;
+        if (fd < 0 || fstat(fd, &st) != 0) return false;
+        size = size_t(st.st_size);
+        if (size % sizeof(geodesic_ray_record))
+            cerr << "[WARN] " << path << " ends with a partial record; ignoring its last "
+                 << size % sizeof(geodesic_ray_record) << " bytes\n";
+        if (size == 0) return true;
+        map = static_cast<const char*>(mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0));
+        if (map == MAP_FAILED) { map = nullptr; return false; }
+        madvise(const_cast<char*>(map), size, MADV_SEQUENTIAL);
+        return true;
+    }
+    ~RaySource() {
+        if (map) munmap(const_cast<char*>(map), size);
+        if (fd >= 0) ::close(fd);
+    }
+
+    // Fills the chunk with up to its capacity; a count of 0 means end of input.
+    void read(RayChunk& c, vector<geodesic_ray_record>& staging) {
+        const size_t cap = c.term.size();
+        if (fd < 0) {
+            // read bytes, not records, so a torn last record is noticed rather than swallowed
+            staging.resize(cap);
+            size_t bytes = fread(staging.data(), 1, cap * sizeof(geodesic_ray_record), stdin);
+            if (bytes % sizeof(geodesic_ray_record))
+                cerr << "[WARN] stdin ends with a partial record; ignoring its last "
+                     << bytes % sizeof(geodesic_ray_record) << " bytes\n";
+            if (ferror(stdin)) readFailed = true;
+            c.load(staging.data(), bytes / sizeof(geodesic_ray_record));
+            return;
+        }
+        size_t total = size / sizeof(geodesic_ray_record);
+        size_t n = std::min(cap, total - consumed);
+        c.load(reinterpret_cast<const geodesic_ray_record*>(map) + consumed, n);
+        consumed += n;
+        // drop the pages behind us so resident memory stays bounded
+        size_t page = size_t(sysconf(_SC_PAGESIZE));
+        size_t upto = consumed * sizeof(geodesic_ray_record) / page * page;
+        if (upto > released) {
+            madvise(const_cast<char*>(map) + released, upto - released, MADV_DONTNEED);
+            released = upto;
+        }
+    }
+
+    bool readFailed = false;   // stdin error; the records before it were traced
+
+private:
+    int fd = -1;
+    const char* map = nullptr;
+    size_t size = 0, consumed = 0, released = 0;
+};
+
+int main(int argc, char** argv) {
+    CliArgs args(argc, argv);
+    const double rs = args.has("rs") ? args.num("rs", 0.0) : geodesic_schwarzschild_radius(args.num("mass", 8.54e36));
+    const size_t chunk = size_t(std::max<long long>(1024, args.integer("chunk", 65536)));
+    const int buffers = int(std::max<long long>(3, args.integer("buffers", 4)));
+
+    geodesic_params params;
+    geodesic_default_params(rs, &params);
+    params.escape_radius = args.num("escape", 0.0) * rs;
+    params.step_scale = args.num("step", params.step_scale);
+    params.max_steps = int32_t(args.integer("max-steps", params.max_steps));
+    params.disk_inner = args.num("disk-inner", 0.0) * rs;
+    params.disk_outer = args.num("disk-outer", 0.0) * rs;
+    params.stop_at_disk = int32_t(args.integer("stop-at-disk", 1));
+    if (int r = geodesic_check_params(&params)) {   // before any output exists
+        cerr << "Bad trace parameters: " << geodesic_error_string(r) << "\n";
+        return EXIT_FAILURE;
+    }
+
+    RaySource source;
+    if (!source.open(args.str("in", ""))) {
+        cerr << "Cannot map input " << args.str("in", "") << ": " << strerror(errno) << "\n";
+        return EXIT_FAILURE;
+    }
+    string outPath = args.str("out", "-");
+    FILE* out = outPath == "-" ? stdout : fopen(outPath.c_str(), "wb");
+    if (!out) {
+        cerr << "Cannot open output " << outPath << "\n";
+        return EXIT_FAILURE;
+    }
+    geodesic_context* ctx = geodesic_create(unsigned(args.integer("threads", 0)));
+    if (!ctx) {
+        cerr << "Cannot create geodesic context\n";
+        return EXIT_FAILURE;
+    }
+
+    vector<unique_ptr<RayChunk>> pool;
+    ChunkQueue freeChunks, loaded, traced;
+    for (int i = 0; i < buffers; ++i) {
+        pool.emplace_back(new RayChunk(chunk));
+        freeChunks.push(pool.back().get());
+    }
+
+    auto t0 = Clock::now();
+    size_t totalRays = 0;
+    bool writeFailed = false;
+    // reader → tracer (this thread, all pool threads per chunk) → writer; order is FIFO throughout
+    thread reader([&] {
+        vector<geodesic_ray_record> staging;
+        for (;;) {
+            RayChunk* c = freeChunks.pop();
+            source.read(*c, staging);
+            bool last = c->last = c->count == 0;
+            loaded.push(c);
+            if (last) return;
+        }
+    });
+    thread writer([&] {
+        vector<geodesic_result_record> packed(chunk);
+        for (;;) {
+            RayChunk* c = traced.pop();
+            if (c->last) return;
+            c->pack(packed.data());
+            if (!writeFailed && fwrite(packed.data(), sizeof(geodesic_result_record), c->count, out) != c->count)
+                writeFailed = true;   // keep draining so the pipeline shuts down
+            freeChunks.push(c);
+        }
+    });
+    int rc = GEODESIC_OK;
+    for (;;) {
+        RayChunk* c = loaded.pop();
+        bool last = c->last;   // c may be recycled as soon as it is pushed on
+        if (!last) {
+            geodesic_rays in = c->rays();
+            geodesic_results res = c->results();
+            int r = geodesic_trace_batch(ctx, &params, c->count, &in, &res);
+            if (r != GEODESIC_OK) rc = r;
+            totalRays += c->count;
+        }
+        traced.push(c);
+        if (last) break;
+    }
+    reader.join();
+    writer.join();
+    geodesic_destroy(ctx);
+    bool closed = out == stdout ? fflush(out) == 0 : fclose(out) == 0;
+    double secs = chrono::duration<double>(Clock::now() - t0).count();
+
+    if (rc != GEODESIC_OK) {
+        cerr << "Trace failed: " << geodesic_error_string(rc) << "\n";
+        return EXIT_FAILURE;
+    }
+    if (source.readFailed) {
+        cerr << "Failed reading rays from stdin after " << totalRays << " rays\n";
+        return EXIT_FAILURE;
+    }
+    if (writeFailed || !closed) {
+        cerr << "Failed writing results to " << outPath << "\n";
+        return EXIT_FAILURE;
+    }
+    cerr << "[INFO] Traced " << totalRays << " rays in " << secs << " s ("
+         << (secs > 0 ? totalRays / secs : 0.0) << " rays/s)\n";
+    return 0;
+}
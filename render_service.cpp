@@ -0,0 +1,794 @@
+// Long-running render service: camera/scene parameters in, PPM images out.
+//
+//   BlackHoleService --listen tcp:127.0.0.1:8080
+//   curl -o view.ppm 'http://127.0.0.1:8080/render?distance=20&inclination=80&width=640&height=360'
+//   curl 'http://127.0.0.1:8080/stats'
+//
+// Query parameters are BlackHoleRender's flags (width, height, mass, distance,
+// azimuth, inclination, fov, r-in, r-out, exposure, t-max) in the same units,
+// plus a free look from the orbit camera (yaw, pitch, roll in degrees) and an
+// observer velocity (beta-x, beta-y, beta-z in units of c along the camera's
+// right, up and forward axes). Every value is snapped to a fixed quantum
+// before anything is looked up, so requests that differ only by float noise
+// share results:
+//
+//   frame cache    — shaded images, keyed by all parameters
+//   G-buffer cache — traced views, keyed by the geometric ones; a request that
+//                    only changes exposure or t-max is re-shaded, not re-traced
+//   sphere cache   — direction cubemaps (direction_cache.h), keyed by the
+//                    observer position and disk; once --sphere-after distinct
+//                    views were traced from one position, a cubemap of its
+//                    whole sky is built and further rotations, fov changes and
+//                    boosts from there are resampled from it without tracing
+//
+// Requests that miss the caches go to the batcher. It collects everything
+// that arrives within --batch-ms, merges duplicate views into one job and
+// traces the whole batch as one parallel pass over all rows, so many small
+// concurrent requests keep the pool busy instead of each paying its own
+// start-up. By default views are sampled from deflection tables shared by all
+// requests at the same camera radius (deflection_table.h); --trace integrates
+// every pixel instead and matches BlackHoleRender exactly.
+//
+// While no request is waiting, the batcher traces ahead. Each client's poses
+// (grouped by the optional `session` query parameter) feed a MotionPredictor
+// (camera_motion.h) that extrapolates the orbit or zoom --prefetch steps and
+// adds the interactive app's camera presets; those views are traced into the
+// G-buffer cache one at a time and abandoned between rows as soon as a real
+// request arrives, unless that request is for the view being prefetched.
+// --prefetch 0 turns this off.
+//
+// HTTP/1.1 responses, one request per connection ("Connection: close"); a
+// client gets REQUEST_TIMEOUT seconds to send its request. POSIX only.
+#include "geodesic_core.h"
+#include "observer.h"
+#include "gbuffer.h"
+#include "deflection_table.h"
+#include "direction_cache.h"
+#include "camera_motion.h"
+#include "emission_tables.h"
+#include "disk_shading.h"
+#include "checkpoint.h"
+#include "lru_cache.h"
+#include "parallel.h"
+#include "cli_args.h"
+#include "socket_io.h"
+#include <signal.h>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <condition_variable>
+#include <deque>
+#include <future>
+#include <iostream>
+#include <map>
+#include <set>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+using namespace std;
+using Clock = std::chrono::steady_clock;
+
+// ------------------------------------------------------------ parameters -- //
+
+struct ParamSpec {
+    const char* name;
+    double quantum;
+    double def;            // NaN: derived (distance defaults to BlackHoleRender's camera)
+    double lo, hi;
+};
+
+// Geometry first: the G-buffer key is the first GEOMETRY_PARAMS entries, and
+// entries OBSERVER_FIRST.. OBSERVER_FIRST + OBSERVER_PARAMS fix what the
+// observer's sky looks like, whatever the camera orientation and velocity.
+const ParamSpec PARAMS[] = {
+    { "width",       1.0,               800.0, 1.0,    8192.0 },
+    { "height",      1.0,               600.0, 1.0,    8192.0 },
+    { "mass",        SAGA_MASS * 1e-6,  SAGA_MASS, 1e20, 1e45 },
+    { "distance",    1e-3,              NAN,   1.01,   1e6 },
+    { "azimuth",     1e-5,              0.0,   -1e3,   1e3 },
+    { "inclination", 1e-3,              90.0,  -360.0, 360.0 },
+    { "r-in",        1e-4,              2.2,   0.5,    1e4 },
+    { "r-out",       1e-4,              5.2,   0.5,    1e4 },
+    { "fov",         1e-3,              60.0,  0.01,   179.0 },
+    { "yaw",         1e-3,              0.0,   -360.0, 360.0 },
+    { "pitch",       1e-3,              0.0,   -360.0, 360.0 },
+    { "roll",        1e-3,              0.0,   -360.0, 360.0 },
+    { "beta-x",      1e-5,              0.0,   -0.99,  0.99 },
+    { "beta-y",      1e-5,              0.0,   -0.99,  0.99 },
+    { "beta-z",      1e-5,              0.0,   -0.99,  0.99 },
+    { "exposure",    1e-3,              1.5,   0.0,    1e6 },
+    { "t-max",       1.0,               1.5e4, 1.0,    1e9 },
+};
+constexpr size_t NUM_PARAMS = sizeof(PARAMS) / sizeof(PARAMS[0]);
+constexpr size_t GEOMETRY_PARAMS = 15;
+constexpr size_t OBSERVER_FIRST = 2, OBSERVER_PARAMS = 6;
+constexpr int64_t MAX_PIXELS = 4096LL * 4096LL;   // ~600 MB of G-buffer; larger stills: BlackHolePoster
+constexpr double REQUEST_TIMEOUT = 10.0;          // seconds to receive a request's headers
+enum { P_WIDTH, P_HEIGHT, P_MASS, P_DISTANCE, P_AZIMUTH, P_INCLINATION, P_RIN, P_ROUT,
+       P_FOV, P_YAW, P_PITCH, P_ROLL, P_BETA_X, P_BETA_Y, P_BETA_Z, P_EXPOSURE, P_TMAX };
+
+using FrameKey = array<int64_t, NUM_PARAMS>;
+using GeometryKey = array<int64_t, GEOMETRY_PARAMS>;
+using ObserverKey = array<int64_t, OBSERVER_PARAMS>;
+
+struct KeyHash {
+    template <class A> size_t operator()(const A& a) const { return size_t(hashBytes(a.data(), sizeof(a))); }
+};
+
+// Quantized request; value(i) is what gets rendered.
+struct SceneParams {
+    FrameKey q{};
+    double value(int i) const { return double(q[i]) * PARAMS[i].quantum; }
+    GeometryKey geometry() const {
+        GeometryKey g;
+        copy(q.begin(), q.begin() + GEOMETRY_PARAMS, g.begin());
+        return g;
+    }
+    ObserverKey observer() const {
+        ObserverKey o;
+        copy(q.begin() + OBSERVER_FIRST, q.begin() + OBSERVER_FIRST + OBSERVER_PARAMS, o.begin());
+        return o;
+    }
+    int width() const { return int(q[P_WIDTH]); }
+    int height() const { return int(q[P_HEIGHT]); }
+    double rs() const { return schwarzschildRadius(value(P_MASS)); }
+
+    // The orbit camera turned by yaw/pitch/roll.
+    ObserverView view() const {
+        ObserverView v = ObserverView::orbit(value(P_DISTANCE) * rs(), value(P_AZIMUTH),
+                                             value(P_INCLINATION) * GEO_PI / 180.0, value(P_FOV),
+                                             double(width()) / height());
+        const double deg = GEO_PI / 180.0;
+        return v.rotated(value(P_YAW) * deg, value(P_PITCH) * deg, value(P_ROLL) * deg);
+    }
+    // Observer velocity in world coordinates, through the camera axes of v.
+    glm::dvec3 beta(const ObserverView& v) const {
+        return value(P_BETA_X) * v.right + value(P_BETA_Y) * v.up + value(P_BETA_Z) * v.forward;
+    }
+    TraceParams traceParams() const {
+        TraceParams tp;
+        tp.rs = rs();
+        tp.escapeRadius = std::max(2.0 * value(P_ROUT), 1.01 * value(P_DISTANCE)) * tp.rs;
+        tp.diskInner = value(P_RIN) * tp.rs;
+        tp.diskOuter = value(P_ROUT) * tp.rs;
+        tp.stopAtDisk = true;
+        return tp;
+    }
+};
+
+// Static-frame sample for a camera direction seen at velocity beta.
+template <class Sampler>
+GSample boosted(const glm::dvec3& dir, const glm::dvec3& beta, const Sampler& sample) {
+    double doppler;
+    GSample s = sample(aberrate(dir, beta, doppler));
+    if (s.kind == GSampleKind::Disk) s.g = float(s.g * doppler);
+    return s;
+}
+
+string urlDecode(const string& s) {
+    string out;
+    for (size_t i = 0; i < s.size(); ++i) {
+        if (s[i] == '%' && i + 2 < s.size()) {
+            out += char(strtol(s.substr(i + 1, 2).c_str(), nullptr, 16));
+            i += 2;
+        } else {
+            out += s[i] == '+' ? ' ' : s[i];
+        }
+    }
+    return out;
+}
+
+bool parseQuery(const string& query, SceneParams& p, string& session, string& error) {
+    map<string, string> given;
+    stringstream ss(query);
+    string item;
+    while (getline(ss, item, '&')) {
+        if (item.empty()) continue;
+        size_t eq = item.find('=');
+        string key = urlDecode(item.substr(0, eq));
+        given[key] = eq == string::npos ? "" : urlDecode(item.substr(eq + 1));
+    }
+    double raw[NUM_PARAMS];
+    for (size_t i = 0; i < NUM_PARAMS; ++i) {
+        auto it = given.find(PARAMS[i].name);
+        if (it == given.end()) { raw[i] = PARAMS[i].def; continue; }
+        char* end = nullptr;
+        raw[i] = strtod(it->second.c_str(), &end);
+        if (end == it->second.c_str() || *end != '\0') { error = string("bad value for ") + PARAMS[i].name; return false; }
+        given.erase(it);
+    }
+    auto it = given.find("session");
+    if (it != given.end()) {
+        session = it->second;
+        given.erase(it);
+    }
+    if (!given.empty()) { error = "unknown parameter " + given.begin()->first; return false; }
+    if (std::isnan(raw[P_DISTANCE])) raw[P_DISTANCE] = 6.34194e10 / schwarzschildRadius(raw[P_MASS]);
+    for (size_t i = 0; i < NUM_PARAMS; ++i) {
+        if (!(raw[i] >= PARAMS[i].lo && raw[i] <= PARAMS[i].hi)) {
+            error = string(PARAMS[i].name) + " out of range";
+            return false;
+        }
+        p.q[i] = llround(raw[i] / PARAMS[i].quantum);
+    }
+    if (p.q[P_ROUT] <= p.q[P_RIN]) { error = "r-out must exceed r-in"; return false; }
+    if (raw[P_BETA_X] * raw[P_BETA_X] + raw[P_BETA_Y] * raw[P_BETA_Y] + raw[P_BETA_Z] * raw[P_BETA_Z] >= 0.99 * 0.99) {
+        error = "observer speed must stay below 0.99 c";
+        return false;
+    }
+    if (int64_t(p.width()) * p.height() > MAX_PIXELS) {
+        error = "image too large (at most " + to_string(MAX_PIXELS) + " pixels)";
+        return false;
+    }
+    return true;
+}
+
+// --------------------------------------------------------------- batcher -- //
+
+using GBuffer = vector<GSample>;
+using GBufferPtr = shared_ptr<const GBuffer>;
+
+// Collects G-buffer requests for a short window, merges duplicates and traces
+// each batch as one parallel pass.
+class TraceBatcher {
+public:
+    TraceBatcher(LruCache<GeometryKey, GBuffer, KeyHash>& gbuffers, ThreadPool& pool,
+                 chrono::microseconds window, bool exact)
+        : gbuffers(gbuffers), pool(pool), window(window), exact(exact), tables(size_t(256) << 20) {
+        worker = thread([this] { run(); });
+    }
+    ~TraceBatcher() {
+        {
+            lock_guard<mutex> lock(mtx);
+            stopping = true;
+        }
+        cv.notify_all();
+        worker.join();
+    }
+
+    shared_future<GBufferPtr> request(const SceneParams& p) {
+        GeometryKey key = p.geometry();
+        lock_guard<mutex> lock(mtx);
+        auto it = inflight.find(key);
+        if (it != inflight.end()) {
+            if (prefetching && key == prefetchKey) prefetchWanted = true;   // keep tracing it
+            coalesced++;
+            return it->second;
+        }
+        if (GBufferPtr ready = gbuffers.get(key)) {   // finished since the caller's miss
+            promise<GBufferPtr> done;
+            done.set_value(ready);
+            return done.get_future().share();
+        }
+        queue.emplace_back(p, promise<GBufferPtr>());
+        shared_future<GBufferPtr> fut = queue.back().second.get_future().share();
+        inflight.emplace(key, fut);
+        foregroundPending = true;
+        cv.notify_one();
+        return fut;
+    }
+
+    // Queues predicted views (most likely first) to trace while idle. They go
+    // ahead of older predictions, the oldest of which are dropped.
+    void prefetch(const vector<SceneParams>& views) {
+        lock_guard<mutex> lock(mtx);
+        for (size_t i = views.size(); i-- > 0;) {
+            GeometryKey key = views[i].geometry();
+            if (inflight.count(key)) continue;
+            for (auto it = prefetchQueue.begin(); it != prefetchQueue.end(); ++it)
+                if (it->geometry() == key) { prefetchQueue.erase(it); break; }
+            prefetchQueue.push_front(views[i]);
+        }
+        while (prefetchQueue.size() > MAX_PREFETCH) prefetchQueue.pop_back();
+        cv.notify_one();
+    }
+
+    // True once per view that was cached by a prefetch, on its first use.
+    bool takePrefetched(const GeometryKey& key) {
+        lock_guard<mutex> lock(mtx);
+        return prefetchedKeys.erase(key) > 0;
+    }
+
+    // Deflection table for p's camera radius, or null when tracing exactly;
+    // also used by cubemap builds from request threads, so concurrent callers
+    // for one radius wait for the first one's build.
+    shared_ptr<const DeflectionTable> tableFor(const SceneParams& p, const TraceParams& tp) {
+        if (exact) return nullptr;
+        // tables are in units of rs: one per (distance, escape radius) serves every mass
+        TableKey tableKey = { p.q[P_DISTANCE], llround(tp.escapeRadius / tp.rs * 1e4) };
+        if (auto table = tables.get(tableKey)) return table;
+        promise<TablePtr> built;
+        shared_future<TablePtr> building;
+        {
+            lock_guard<mutex> lock(tableMtx);
+            auto it = tableInflight.find(tableKey);
+            if (it != tableInflight.end()) building = it->second;
+            else if (auto table = tables.get(tableKey)) return table;   // finished since the miss above
+            else tableInflight.emplace(tableKey, built.get_future().share());
+        }
+        if (building.valid()) return building.get();   // rethrows if that build failed
+        TablePtr tab;
+        exception_ptr failure;
+        try {
+            tab = make_shared<const DeflectionTable>(
+                DeflectionTable::build(p.value(P_DISTANCE), tp.escapeRadius / tp.rs, 2048, 2048, pool));
+            tables.put(tableKey, tab, tab->r.size() * 2 * sizeof(float) + tab->rays.size() * sizeof(DeflectionRay));
+            tableBuilds++;
+            built.set_value(tab);
+        } catch (...) {
+            failure = current_exception();
+            built.set_exception(failure);
+        }
+        lock_guard<mutex> lock(tableMtx);
+        tableInflight.erase(tableKey);
+        if (failure) rethrow_exception(failure);
+        return tab;
+    }
+
+    atomic<size_t> batches{0}, views{0}, coalesced{0}, tableBuilds{0}, prefetched{0}, prefetchAborts{0}, failedBatches{0};
+
+private:
+    using TableKey = array<int64_t, 2>;
+    using TablePtr = shared_ptr<const DeflectionTable>;
+
+    struct Job {
+        SceneParams p;
+        ObserverView view;
+        glm::dvec3 beta;
+        TraceParams tp;
+        shared_ptr<const DeflectionTable> table;
+        shared_ptr<GBuffer> gbuf;
+    };
+
+    void run() {
+        for (;;) {
+            vector<pair<SceneParams, promise<GBufferPtr>>> batch;
+            SceneParams ahead;
+            {
+                unique_lock<mutex> lock(mtx);
+                cv.wait(lock, [&] { return stopping || !queue.empty() || !prefetchQueue.empty(); });
+                if (stopping) return;
+                if (queue.empty()) {
+                    ahead = prefetchQueue.front();
+                    prefetchQueue.pop_front();
+                } else {
+                    cv.wait_for(lock, window, [&] { return stopping; });   // let concurrent requests join
+                    batch.swap(queue);
+                    foregroundPending = false;
+                }
+            }
+            if (batch.empty()) {
+                runPrefetch(ahead);
+                continue;
+            }
+            vector<Job> jobs(batch.size());
+            try {
+                for (size_t i = 0; i < batch.size(); ++i) prepare(batch[i].first, jobs[i]);
+
+                vector<pair<uint32_t, uint32_t>> rows;   // (job, row) over the whole batch
+                for (size_t j = 0; j < jobs.size(); ++j)
+                    for (int y = 0; y < jobs[j].p.height(); ++y) rows.emplace_back(uint32_t(j), uint32_t(y));
+                pool.parallelFor(0, rows.size(), 1, [&](size_t i0, size_t i1, unsigned) {
+                    for (size_t i = i0; i < i1; ++i) traceRow(jobs[rows[i].first], int(rows[i].second));
+                });
+            } catch (...) {
+                // e.g. bad_alloc for the G-buffers: fail this batch's requests, keep serving
+                exception_ptr failure = current_exception();
+                lock_guard<mutex> lock(mtx);
+                for (auto& [p, done] : batch) {
+                    done.set_exception(failure);
+                    inflight.erase(p.geometry());
+                }
+                failedBatches++;
+                continue;
+            }
+
+            batches++;
+            views += jobs.size();
+            for (size_t i = 0; i < jobs.size(); ++i) {
+                GeometryKey key = jobs[i].p.geometry();
+                gbuffers.put(key, jobs[i].gbuf, jobs[i].gbuf->size() * sizeof(GSample));
+                batch[i].second.set_value(jobs[i].gbuf);
+                lock_guard<mutex> lock(mtx);
+                inflight.erase(key);
+            }
+        }
+    }
+
+    // Traces one predicted view into the cache. Between rows it gives way to
+    // waiting requests, unless one of them asked for this very view.
+    void runPrefetch(const SceneParams& p) {
+        GeometryKey key = p.geometry();
+        promise<GBufferPtr> done;
+        {
+            lock_guard<mutex> lock(mtx);
+            if (inflight.count(key) || gbuffers.get(key)) return;
+            inflight.emplace(key, done.get_future().share());
+            prefetching = true;
+            prefetchKey = key;
+            prefetchWanted = false;
+        }
+        Job job;
+        try {
+            prepare(p, job);
+        } catch (...) {
+            // a prediction is not worth failing over; anyone who asked for it since gets the error
+            lock_guard<mutex> lock(mtx);
+            prefetching = false;
+            done.set_exception(current_exception());
+            inflight.erase(key);
+            prefetchAborts++;
+            return;
+        }
+        atomic<bool> aborted{false};
+        pool.parallelFor(0, size_t(p.height()), 1, [&](size_t y0, size_t y1, unsigned) {
+            for (size_t y = y0; y < y1; ++y) {
+                if (aborted || (foregroundPending && !prefetchWanted)) { aborted = true; return; }
+                traceRow(job, int(y));
+            }
+        });
+
+        lock_guard<mutex> lock(mtx);
+        prefetching = false;
+        if (!aborted) {
+            gbuffers.put(key, job.gbuf, job.gbuf->size() * sizeof(GSample));
+            done.set_value(job.gbuf);
+            inflight.erase(key);
+            if (prefetchedKeys.size() > 4096) prefetchedKeys.clear();
+            if (!prefetchWanted) prefetchedKeys.insert(key);
+            prefetched++;
+            return;
+        }
+        prefetchAborts++;
+        if (prefetchWanted) {
+            // requested after the abort decision: finish it with the next batch
+            queue.insert(queue.begin(), make_pair(p, std::move(done)));
+            foregroundPending = true;
+        } else {
+            inflight.erase(key);
+            prefetchQueue.push_front(p);
+        }
+    }
+
+    void prepare(const SceneParams& p, Job& job) {
+        job.p = p;
+        job.view = p.view();
+        job.beta = p.beta(job.view);
+        job.tp = p.traceParams();
+        job.gbuf = make_shared<GBuffer>(size_t(p.width()) * p.height());
+        job.table = tableFor(p, job.tp);
+    }
+
+    void traceRow(Job& job, int y) const {
+        const int W = job.p.width(), H = job.p.height();
+        GSample* out = job.gbuf->data() + size_t(y) * W;
+        auto sample = [&](const glm::dvec3& dir) {
+            return job.table ? job.table->sample(job.view.pos, dir, job.tp.rs, job.tp.diskInner, job.tp.diskOuter)
+                             : traceSample(job.view, dir, job.tp);
+        };
+        for (int x = 0; x < W; ++x)
+            out[x] = boosted(job.view.pixelDir(x, double(y), W, H), job.beta, sample);
+    }
+
+    LruCache<GeometryKey, GBuffer, KeyHash>& gbuffers;
+    ThreadPool& pool;
+    chrono::microseconds window;
+    bool exact;
+    LruCache<TableKey, DeflectionTable, KeyHash> tables;
+    mutex tableMtx;
+    map<TableKey, shared_future<TablePtr>> tableInflight;
+
+    mutex mtx;
+    condition_variable cv;
+    bool stopping = false;
+    vector<pair<SceneParams, promise<GBufferPtr>>> queue;
+    map<GeometryKey, shared_future<GBufferPtr>> inflight;
+    atomic<bool> foregroundPending{false};
+
+    static constexpr size_t MAX_PREFETCH = 32;
+    deque<SceneParams> prefetchQueue;
+    bool prefetching = false;
+    GeometryKey prefetchKey{};
+    atomic<bool> prefetchWanted{false};
+    set<GeometryKey> prefetchedKeys;   // cached by a prefetch, not yet requested
+    thread worker;
+};
+
+// --------------------------------------------------------------- service -- //
+
+using CubemapPtr = shared_ptr<const DirectionCubemap>;
+
+struct SphereOptions {
+    size_t bytes = size_t(512) << 20;
+    int after = 2;          // distinct traced views from one observer before its cubemap is built; 0: never
+    int faceSize = 256;
+    int refine = 4;
+};
+
+struct RenderService {
+    LruCache<FrameKey, string, KeyHash> frames;
+    LruCache<GeometryKey, GBuffer, KeyHash> gbuffers;
+    LruCache<array<int64_t, 3>, EmissionTables, KeyHash> emission;
+    LruCache<ObserverKey, DirectionCubemap, KeyHash> spheres;
+    SphereOptions sphereOpts;
+    TraceBatcher batcher;
+    int prefetchAhead;
+    atomic<size_t> requests{0}, frameHits{0}, gbufferHits{0}, sphereHits{0}, sphereBuilds{0}, prefetchHits{0}, errors{0};
+    Clock::time_point started = Clock::now();
+
+    RenderService(size_t frameBytes, size_t gbufferBytes, chrono::microseconds window, bool exact,
+                  const SphereOptions& sphereOpts, int prefetchAhead)
+        : frames(frameBytes), gbuffers(gbufferBytes), emission(size_t(64) << 20), spheres(sphereOpts.bytes),
+          sphereOpts(sphereOpts), batcher(gbuffers, defaultPool(), window, exact), prefetchAhead(prefetchAhead) {}
+
+    shared_ptr<const EmissionTables> emissionFor(const SceneParams& p) {
+        array<int64_t, 3> key = { p.q[P_MASS], p.q[P_RIN], p.q[P_ROUT] };
+        if (auto t = emission.get(key)) return t;
+        double rs = p.rs();
+        auto t = make_shared<const EmissionTables>(
+            EmissionTables::build(p.value(P_RIN) * rs, p.value(P_ROUT) * rs, rs, 1.5e4));
+        emission.put(key, t, sizeof(EmissionTables) + 4096 * sizeof(float));
+        return t;
+    }
+
+    // Cubemap of p's observer sky: cached, or built now by the request that
+    // reaches --sphere-after views from there (concurrent requests wait for
+    // that one build); null while the observer has had fewer views.
+    CubemapPtr sphereFor(const SceneParams& p) {
+        if (sphereOpts.after <= 0) return nullptr;
+        ObserverKey key = p.observer();
+        if (CubemapPtr hit = spheres.get(key)) return hit;
+        promise<CubemapPtr> built;
+        shared_future<CubemapPtr> building;
+        {
+            lock_guard<mutex> lock(sphereMtx);
+            auto it = sphereInflight.find(key);
+            if (it != sphereInflight.end()) {
+                building = it->second;
+            } else {
+                if (viewsSeen.size() > 4096) viewsSeen.clear();   // only recent observers matter
+                if (++viewsSeen[key] < sphereOpts.after) return nullptr;
+                viewsSeen.erase(key);
+                sphereInflight.emplace(key, built.get_future().share());
+            }
+        }
+        if (building.valid()) return building.get();
+        const TraceParams tp = p.traceParams();
+        const ObserverView view = p.view();
+        shared_ptr<const DeflectionTable> table = batcher.tableFor(p, tp);
+        auto sample = [&](const glm::dvec3& dir) {
+            return table ? table->sample(view.pos, dir, tp.rs, tp.diskInner, tp.diskOuter) : traceSample(view, dir, tp);
+        };
+        auto m = make_shared<const DirectionCubemap>(
+            DirectionCubemap::build(view.pos, sphereOpts.faceSize, sphereOpts.refine, sample));
+        spheres.put(key, m, m->bytes());
+        sphereBuilds++;
+        built.set_value(m);
+        lock_guard<mutex> lock(sphereMtx);
+        sphereInflight.erase(key);
+        return m;
+    }
+
+    // The view of p resampled from its observer's cubemap.
+    GBufferPtr resample(const SceneParams& p, const DirectionCubemap& m) {
+        const int W = p.width(), H = p.height();
+        const ObserverView view = p.view();
+        const glm::dvec3 beta = p.beta(view);
+        auto gbuf = make_shared<GBuffer>(size_t(W) * H);
+        auto lookup = [&](const glm::dvec3& dir) { return m.lookup(dir); };
+        defaultPool().parallelFor(0, size_t(H), 4, [&](size_t y0, size_t y1, unsigned) {
+            for (size_t y = y0; y < y1; ++y)
+                for (int x = 0; x < W; ++x)
+                    (*gbuf)[y * W + x] = boosted(view.pixelDir(x, double(y), W, H), beta, lookup);
+        });
+        gbuffers.put(p.geometry(), gbuf, gbuf->size() * sizeof(GSample));
+        return gbuf;
+    }
+
+    // Records p's pose for its session and queues the views likely to follow it.
+    void predictFrom(const SceneParams& p, const string& session) {
+        if (prefetchAhead <= 0) return;
+        vector<CameraPose> poses;
+        {
+            lock_guard<mutex> lock(predictMtx);
+            if (predictors.size() >= 1024 && !predictors.count(session)) predictors.clear();
+            MotionPredictor& m = predictors[session];
+            m.record({ p.value(P_DISTANCE), p.value(P_AZIMUTH), p.value(P_INCLINATION) * GEO_PI / 180.0 },
+                     chrono::duration<double>(Clock::now() - started).count());
+            poses = m.predict(prefetchAhead, 1.0 / p.rs());   // presets are in meters
+        }
+        vector<SceneParams> views;
+        for (const CameraPose& pose : poses) {
+            SceneParams v = p;
+            const int index[] = { P_DISTANCE, P_AZIMUTH, P_INCLINATION };
+            const double raw[] = { pose.radius, pose.azimuth, pose.elevation * 180.0 / GEO_PI };
+            for (int i = 0; i < 3; ++i) {
+                const ParamSpec& spec = PARAMS[index[i]];
+                v.q[index[i]] = llround(std::clamp(raw[i], spec.lo, spec.hi) / spec.quantum);
+            }
+            if (v.q != p.q && !gbuffers.get(v.geometry())) views.push_back(v);
+        }
+        if (!views.empty()) batcher.prefetch(views);
+    }
+
+    // Returns the PPM bytes and which level answered ("frame", "gbuffer", "sphere" or "trace").
+    shared_ptr<const string> render(const SceneParams& p, const string& session, const char*& source) {
+        requests++;
+        if (auto hit = frames.get(p.q)) {
+            frameHits++;
+            source = "frame";
+            predictFrom(p, session);
+            return hit;
+        }
+        GBufferPtr gbuf = gbuffers.get(p.geometry());
+        if (gbuf) {
+            gbufferHits++;
+            if (batcher.takePrefetched(p.geometry())) prefetchHits++;
+            source = "gbuffer";
+        }
+        else if (CubemapPtr m = sphereFor(p)) { gbuf = resample(p, *m); sphereHits++; source = "sphere"; }
+        else { gbuf = batcher.request(p).get(); source = "trace"; }
+
+        EmissionTables tables = *emissionFor(p);
+        tables.tMax = float(p.value(P_TMAX));
+        ShadeParams sp;
+        sp.exposure = p.value(P_EXPOSURE);
+        const int W = p.width(), H = p.height();
+        string header = "P6\n" + to_string(W) + " " + to_string(H) + "\n255\n";
+        auto ppm = make_shared<string>(header.size() + gbuf->size() * 3, '\0');
+        memcpy(&(*ppm)[0], header.data(), header.size());
+        shadeRGB8(gbuf->data(), 0, gbuf->size(), tables, sp, reinterpret_cast<unsigned char*>(&(*ppm)[header.size()]));
+        frames.put(p.q, ppm, ppm->size());
+        predictFrom(p, session);
+        return ppm;
+    }
+
+    string statsText() {
+        auto f = frames.stats();
+        auto g = gbuffers.stats();
+        auto c = spheres.stats();
+        ostringstream os;
+        os << "{\"uptime_s\": " << chrono::duration<double>(Clock::now() - started).count()
+           << ", \"requests\": " << requests << ", \"errors\": " << errors
+           << ", \"frame_hits\": " << frameHits << ", \"gbuffer_hits\": " << gbufferHits
+           << ", \"batches\": " << batcher.batches << ", \"views_traced\": " << batcher.views
+           << ", \"coalesced\": " << batcher.coalesced << ", \"tables_built\": " << batcher.tableBuilds
+           << ", \"sphere_hits\": " << sphereHits << ", \"spheres_built\": " << sphereBuilds
+           << ", \"prefetched\": " << batcher.prefetched << ", \"prefetch_hits\": " << prefetchHits
+           << ", \"prefetch_aborts\": " << batcher.prefetchAborts << ", \"failed_batches\": " << batcher.failedBatches
+           << ", \"frame_cache\": {\"entries\": " << f.entries << ", \"bytes\": " << f.bytes << "}"
+           << ", \"gbuffer_cache\": {\"entries\": " << g.entries << ", \"bytes\": " << g.bytes << "}"
+           << ", \"sphere_cache\": {\"entries\": " << c.entries << ", \"bytes\": " << c.bytes << "}}\n";
+        return os.str();
+    }
+
+private:
+    mutex sphereMtx;
+    map<ObserverKey, int> viewsSeen;                          // G-buffer misses per observer
+    map<ObserverKey, shared_future<CubemapPtr>> sphereInflight;
+    mutex predictMtx;
+    map<string, MotionPredictor> predictors;                  // by session
+};
+
+void sendResponse(int fd, int status, const char* reason, const string& type,
+                  const char* body, size_t bytes, const string& extra = "") {
+    string head = "HTTP/1.1 " + to_string(status) + " " + reason + "\r\nContent-Type: " + type
+                + "\r\nContent-Length: " + to_string(bytes) + "\r\n" + extra + "Connection: close\r\n\r\n";
+    if (sendAll(fd, head.data(), head.size())) sendAll(fd, body, bytes);
+}
+
+void sendError(int fd, int status, const char* reason, const string& message) {
+    string body = message + "\n";
+    sendResponse(fd, status, reason, "text/plain", body.data(), body.size());
+}
+
+void handleConnection(RenderService& service, int fd) {
+    string request;
+    char chunk[4096];
+    const auto deadline = Clock::now() + chrono::duration<double>(REQUEST_TIMEOUT);
+    setRecvTimeout(fd, REQUEST_TIMEOUT);   // bounds each recv; the deadline bounds a trickle of bytes
+    while (request.find("\r\n\r\n") == string::npos && request.size() < 16384 && Clock::now() < deadline) {
+        ssize_t n = recv(fd, chunk, sizeof(chunk), 0);
+        if (n <= 0) break;
+        request.append(chunk, size_t(n));
+    }
+    if (request.find("\r\n\r\n") == string::npos) {
+        if (request.size() >= 16384) sendError(fd, 431, "Request Header Fields Too Large", "request too large");
+        else if (!request.empty()) sendError(fd, 408, "Request Timeout", "incomplete request");
+        close(fd);
+        return;
+    }
+    string method, target;
+    stringstream(request.substr(0, request.find("\r\n"))) >> method >> target;
+    size_t qmark = target.find('?');
+    string path = target.substr(0, qmark);
+    string query = qmark == string::npos ? "" : target.substr(qmark + 1);
+
+    if (method != "GET") {
+        sendError(fd, 405, "Method Not Allowed", "only GET is supported");
+    } else if (path == "/stats") {
+        string body = service.statsText();
+        sendResponse(fd, 200, "OK", "application/json", body.data(), body.size());
+    } else if (path == "/render") {
+        SceneParams p;
+        string session, error;
+        if (!parseQuery(query, p, session, error)) {
+            service.errors++;
+            sendError(fd, 400, "Bad Request", error);
+        } else {
+            const char* source = "";
+            shared_ptr<const string> ppm;
+            string failure;
+            try {
+                ppm = service.render(p, session, source);
+            } catch (const exception& e) {
+                failure = e.what();
+            } catch (...) {
+                failure = "unknown error";
+            }
+            if (ppm) {
+                sendResponse(fd, 200, "OK", "image/x-portable-pixmap", ppm->data(), ppm->size(),
+                             string("X-Render-Source: ") + source + "\r\n");
+            } else {
+                service.errors++;
+                sendError(fd, 500, "Internal Server Error", "render failed: " + failure);
+            }
+        }
+    } else {
+        sendError(fd, 404, "Not Found", "endpoints: /render?<params>, /stats");
+    }
+    close(fd);
+}
+
+int main(int argc, char** argv) {
+    signal(SIGPIPE, SIG_IGN);
+    CliArgs args(argc, argv);
+    Endpoint ep;
+    string listenText = args.str("listen", "tcp:127.0.0.1:8080");
+    if (!Endpoint::parse(listenText, ep)) {
+        cerr << "Bad --listen endpoint '" << listenText << "'\n";
+        return EXIT_FAILURE;
+    }
+    const int maxClients = int(args.integer("max-clients", 256));
+    SphereOptions sphere;
+    sphere.bytes = size_t(args.integer("sphere-cache-mb", 512)) << 20;
+    sphere.after = int(args.integer("sphere-after", 2));
+    sphere.faceSize = int(std::max<long long>(DirectionCubemap::BLOCK, args.integer("sphere-face", 256)));
+    sphere.refine = int(args.integer("sphere-refine", 4));
+    RenderService service(size_t(args.integer("frame-cache-mb", 256)) << 20,
+                          size_t(args.integer("gbuffer-cache-mb", 1024)) << 20,
+                          chrono::microseconds(llround(args.num("batch-ms", 2.0) * 1000.0)),
+                          args.has("trace"), sphere, int(args.integer("prefetch", 3)));
+    int listenFd = listenOn(ep);
+    if (listenFd < 0) {
+        cerr << "Cannot listen on " << ep.str() << ": " << strerror(errno) << "\n";
+        return EXIT_FAILURE;
+    }
+    cout << "[INFO] Render service listening on " << ep.str() << " ("
+         << (args.has("trace") ? "exact tracing" : "deflection tables") << ")" << endl;
+
+    // one thread per connection; they mostly wait on the batcher
+    atomic<int> active{0};
+    for (;;) {
+        int fd = accept(listenFd, nullptr, nullptr);
+        if (fd < 0) {
+            if (errno == EINTR || errno == ECONNABORTED) continue;
+            cerr << "accept failed: " << strerror(errno) << "\n";
+            break;
+        }
+        if (active >= maxClients) {
+            sendError(fd, 503, "Service Unavailable", "too many concurrent requests");
+            close(fd);
+            continue;
+        }
+        active++;
+        thread([&service, &active, fd] {
+            handleConnection(service, fd);
+            active--;
+        }).detach();
+    }
+    close(listenFd);
+    return EXIT_FAILURE;
+}
@@ -0,0 +1,255 @@
+#pragma once
+// Binary snapshots of an n-body scene: bodies, black hole and camera.
+//
+// File layout ("BHSNAP01", fixed-width types in the writer's byte order,
+// recorded in byteOrder; a host of the other order refuses the file rather
+// than swapping it): a 256-byte SnapshotHeader, then one array per
+// SnapshotField, structure-of-arrays, each starting on a 64-byte boundary at
+// the offset the header gives. Readers take the fields they know and treat a
+// zero offset as absent, so fields can be added without a new version.
+//
+// SnapshotWriter writes on its own thread (to "<path>.tmp", renamed over the
+// target like checkpoint.h) so saving never stalls a frame. MappedSnapshot
+// maps a file read-only and hands out the arrays in place: opening costs the
+// same for ten bodies or ten million, and pages are read as they are touched.
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#if defined(_WIN32)
+#  include <fstream>
+#  include <iterator>
+#else
+#  include <fcntl.h>
+#  include <sys/mman.h>
+#  include <sys/stat.h>
+#  include <unistd.h>
+#endif
+
+enum SnapshotField : uint32_t {
+    SNAP_POS_X, SNAP_POS_Y, SNAP_POS_Z,   // float, m
+    SNAP_VEL_X, SNAP_VEL_Y, SNAP_VEL_Z,   // float, m/s
+    SNAP_MASS,                            // float, kg
+    SNAP_RADIUS,                          // float, m; 0 for point bodies that are not drawn
+    SNAP_COLOR,                           // uint32, RGBA8 (red in the low byte)
+    SNAP_FIELDS
+};
+
+enum SnapshotFlags : uint32_t {
+    SNAP_GRAVITY = 1, SNAP_MULTILENS = 2, SNAP_VOLUMETRIC = 4, SNAP_GPU_NBODY = 8
+};
+
+struct SnapshotScene {
+    double holeMass = 0.0;        // kg
+    double holeRs = 0.0;          // m
+    float camRadius = 0.0f;       // m
+    float camAzimuth = 0.0f, camElevation = 0.0f;
+    float camTarget[3] = { 0.0f, 0.0f, 0.0f };
+    uint32_t flags = 0;           // SnapshotFlags
+    uint32_t reserved = 0;
+};
+
+struct SnapshotHeader {
+    char magic[8];                // "BHSNAP01"
+    uint32_t byteOrder;           // 0x01020304 as written
+    uint32_t fieldCount;          // SNAP_FIELDS of the writer
+    uint64_t bodies;
+    SnapshotScene scene;
+    uint64_t offset[SNAP_FIELDS]; // from the start of the file, 0 when absent
+    uint8_t reserved[256 - 8 - 8 - 8 - sizeof(SnapshotScene) - 8 * SNAP_FIELDS];
+};
+static_assert(sizeof(SnapshotHeader) == 256, "snapshot header layout is part of the file format");
+
+// An owned snapshot, filled by the application and handed to SnapshotWriter.
+struct Snapshot {
+    SnapshotScene scene;
+    std::vector<float> field[SNAP_COLOR];   // SNAP_POS_X .. SNAP_RADIUS
+    std::vector<uint32_t> color;
+
+    size_t size() const { return color.size(); }
+    void resize(size_t n) {
+        for (auto& f : field) f.assign(n, 0.0f);
+        color.assign(n, 0xffffffffu);
+    }
+    static constexpr size_t ALIGN = 64;
+    static size_t padded(size_t bytes) { return (bytes + ALIGN - 1) / ALIGN * ALIGN; }
+
+    // Header, then the arrays, through "<path>.tmp".
+    bool write(const std::string& path) const {
+        SnapshotHeader h{};
+        std::memcpy(h.magic, "BHSNAP01", 8);
+        h.byteOrder = 0x01020304u;
+        h.fieldCount = SNAP_FIELDS;
+        h.bodies = size();
+        h.scene = scene;
+        uint64_t at = padded(sizeof(h));
+        for (uint32_t f = 0; f < SNAP_FIELDS; ++f) {
+            h.offset[f] = at;
+            at += padded(size() * 4);
+        }
+
+        std::string tmp = path + ".tmp";
+        FILE* out = std::fopen(tmp.c_str(), "wb");
+        if (!out) return false;
+        static const char zeros[ALIGN] = {};
+        auto put = [&](const void* data, size_t bytes) {
+            return std::fwrite(data, 1, bytes, out) == bytes
+                && std::fwrite(zeros, 1, padded(bytes) - bytes, out) == padded(bytes) - bytes;
+        };
+        bool ok = put(&h, sizeof(h));
+        for (uint32_t f = 0; f < SNAP_COLOR && ok; ++f) ok = put(field[f].data(), size() * 4);
+        ok = ok && put(color.data(), size() * 4);
+        ok = (std::fclose(out) == 0) && ok;
+        if (!ok) { std::remove(tmp.c_str()); return false; }
+        std::remove(path.c_str());   // rename does not replace on Windows
+        return std::rename(tmp.c_str(), path.c_str()) == 0;
+    }
+};
+
+// A snapshot file mapped read-only. The arrays stay valid while it is open.
+class MappedSnapshot {
+public:
+    MappedSnapshot() = default;
+    MappedSnapshot(const MappedSnapshot&) = delete;
+    MappedSnapshot& operator=(const MappedSnapshot&) = delete;
+    ~MappedSnapshot() { close(); }
+
+    bool open(const std::string& path, std::string& error) {
+        close();
+        if (!map(path)) { error = "cannot read " + path; return false; }
+        if (bytes < sizeof(SnapshotHeader)) return fail("truncated header", error);
+        const SnapshotHeader& h = header();
+        if (std::memcmp(h.magic, "BHSNAP", 6) != 0) return fail("not a snapshot", error);
+        if (std::memcmp(h.magic, "BHSNAP01", 8) != 0) return fail("unsupported snapshot version", error);
+        if (h.byteOrder != 0x01020304u) return fail("written with the other byte order", error);
+        if (h.bodies > bytes / 4) return fail("truncated body arrays", error);
+        for (uint32_t f = 0; f < SNAP_FIELDS && f < h.fieldCount; ++f)
+            if (h.offset[f] && (h.offset[f] % 4 || h.offset[f] > bytes || h.bodies > (bytes - h.offset[f]) / 4))
+                return fail("truncated body arrays", error);
+        return true;
+    }
+    void close() {
+#if defined(_WIN32)
+        copy.clear();
+#else
+        if (base) munmap(const_cast<char*>(base), bytes);
+#endif
+        base = nullptr;
+        bytes = 0;
+    }
+
+    bool isOpen() const { return base != nullptr; }
+    size_t size() const { return size_t(header().bodies); }
+    const SnapshotScene& scene() const { return header().scene; }
+    // nullptr for fields this file does not have.
+    const float* field(SnapshotField f) const { return static_cast<const float*>(array(f)); }
+    const uint32_t* colors() const { return static_cast<const uint32_t*>(array(SNAP_COLOR)); }
+
+private:
+    const SnapshotHeader& header() const { return *reinterpret_cast<const SnapshotHeader*>(base); }
+    const void* array(SnapshotField f) const {
+        const SnapshotHeader& h = header();
+        return f < h.fieldCount && h.offset[f] ? base + h.offset[f] : nullptr;
+    }
+    bool fail(const char* why, std::string& error) {
+        error = why;
+        close();
+        return false;
+    }
+    bool map(const std::string& path) {
+#if defined(_WIN32)
+        std::ifstream in(path, std::ios::binary);
+        if (!in) return false;
+        copy.assign(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+        base = copy.data();
+        bytes = copy.size();
+        return !copy.empty();
+#else
+        int fd = ::open(path.c_str(), O_RDONLY);
+        if (fd < 0) return false;
+        struct stat st;
+        void* p = MAP_FAILED;
+        if (fstat(fd, &st) == 0 && st.st_size > 0)
+            p = mmap(nullptr, size_t(st.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+        ::close(fd);   // the mapping keeps the file
+        if (p == MAP_FAILED) return false;
+        base = static_cast<const char*>(p);
+        bytes = size_t(st.st_size);
+        return true;
+#endif
+    }
+
+    const char* base = nullptr;
+    size_t bytes = 0;
+#if defined(_WIN32)
+    std::vector<char> copy;   // no mmap: read the file instead
+#endif
+};
+
+// Writes snapshots on a background thread. A save queued while another is
+// still pending replaces it; the destructor finishes the last one.
+class SnapshotWriter {
+public:
+    // Called on the writer thread after every write.
+    using Done = std::function<void(const std::string& path, size_t bodies, bool ok, double ms)>;
+
+    explicit SnapshotWriter(Done done = nullptr) : done(std::move(done)) {
+        worker = std::thread([this] { run(); });
+    }
+    ~SnapshotWriter() {
+        {
+            std::lock_guard<std::mutex> lock(mtx);
+            stopping = true;
+        }
+        cv.notify_all();
+        worker.join();
+    }
+
+    void save(Snapshot s, std::string path) {
+        {
+            std::lock_guard<std::mutex> lock(mtx);
+            pending = std::move(s);
+            pendingPath = std::move(path);
+            hasPending = true;
+        }
+        cv.notify_all();
+    }
+    bool idle() const {
+        std::lock_guard<std::mutex> lock(mtx);
+        return !hasPending && !writing;
+    }
+
+private:
+    void run() {
+        std::unique_lock<std::mutex> lock(mtx);
+        for (;;) {
+            cv.wait(lock, [this] { return hasPending || stopping; });
+            if (!hasPending) return;
+            Snapshot s = std::move(pending);
+            std::string path = std::move(pendingPath);
+            hasPending = false;
+            writing = true;
+            lock.unlock();
+            auto t0 = std::chrono::steady_clock::now();
+            bool ok = s.write(path);
+            double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - t0).count();
+            if (done) done(path, s.size(), ok, ms);
+            lock.lock();
+            writing = false;
+        }
+    }
+
+    Done done;
+    mutable std::mutex mtx;
+    std::condition_variable cv;
+    Snapshot pending;
+    std::string pendingPath;
+    bool hasPending = false, writing = false, stopping = false;
+    std::thread worker;
+};
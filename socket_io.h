@@ -0,0 +1,161 @@
+#pragma once
+// POSIX stream sockets for the headless tools that talk to other processes.
+//
+// Endpoints are "tcp:host:port" or "unix:/path/to/socket". Messages are
+// framed as [uint32 type][uint32 length][payload], host byte order, so both
+// ends must share an architecture (local worker nodes, not the internet).
+#include <arpa/inet.h>
+#include <fcntl.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <sys/un.h>
+#include <unistd.h>
+#include <cerrno>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <vector>
+
+struct Endpoint {
+    bool unixSocket = false;
+    std::string host;   // or socket path
+    int port = 0;
+
+    static bool parse(const std::string& text, Endpoint& ep) {
+        if (text.rfind("unix:", 0) == 0) {
+            ep.unixSocket = true;
+            ep.host = text.substr(5);
+            return !ep.host.empty();
+        }
+        std::string rest = text.rfind("tcp:", 0) == 0 ? text.substr(4) : text;
+        size_t colon = rest.rfind(':');
+        if (colon == std::string::npos) return false;
+        ep.unixSocket = false;
+        ep.host = rest.substr(0, colon);
+        ep.port = std::atoi(rest.substr(colon + 1).c_str());
+        return ep.port > 0;
+    }
+    std::string str() const { return unixSocket ? "unix:" + host : "tcp:" + host + ":" + std::to_string(port); }
+};
+
+inline int openSocket(const Endpoint& ep, bool listening, int backlog = 64) {
+    int fd = -1;
+    if (ep.unixSocket) {
+        sockaddr_un addr{};
+        addr.sun_family = AF_UNIX;
+        if (ep.host.size() >= sizeof(addr.sun_path)) return -1;
+        std::strcpy(addr.sun_path, ep.host.c_str());
+        fd = ::socket(AF_UNIX, SOCK_STREAM, 0);
+        if (fd < 0) return -1;
+        if (listening) {
+            ::unlink(ep.host.c_str());
+            if (::bind(fd, (sockaddr*)&addr, sizeof(addr)) != 0 || ::listen(fd, backlog) != 0) { ::close(fd); return -1; }
+        } else if (::connect(fd, (sockaddr*)&addr, sizeof(addr)) != 0) {
+            ::close(fd);
+            return -1;
+        }
+        return fd;
+    }
+    addrinfo hints{}, *res = nullptr;
+    hints.ai_family = AF_UNSPEC;
+    hints.ai_socktype = SOCK_STREAM;
+    hints.ai_flags = listening ? AI_PASSIVE : 0;
+    if (::getaddrinfo(ep.host.empty() ? nullptr : ep.host.c_str(), std::to_string(ep.port).c_str(), &hints, &res) != 0)
+        return -1;
+    for (addrinfo* ai = res; ai; ai = ai->ai_next) {
+        fd = ::socket(ai->ai_family, ai->ai_socktype, ai->ai_protocol);
+        if (fd < 0) continue;
+        int one = 1;
+        if (listening) {
+            ::setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+            if (::bind(fd, ai->ai_addr, ai->ai_addrlen) == 0 && ::listen(fd, backlog) == 0) break;
+        } else if (::connect(fd, ai->ai_addr, ai->ai_addrlen) == 0) {
+            ::setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+            break;
+        }
+        ::close(fd);
+        fd = -1;
+    }
+    ::freeaddrinfo(res);
+    return fd;
+}
+
+inline int listenOn(const Endpoint& ep) { return openSocket(ep, true); }
+inline int connectTo(const Endpoint& ep) { return openSocket(ep, false); }
+
+// Bounds blocking reads on fd; 0 waits forever again.
+inline bool setRecvTimeout(int fd, double seconds) {
+    timeval tv{};
+    tv.tv_sec = time_t(seconds);
+    tv.tv_usec = suseconds_t((seconds - double(tv.tv_sec)) * 1e6);
+    return ::setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv)) == 0;
+}
+
+inline bool sendAll(int fd, const void* data, size_t bytes) {
+    const char* p = static_cast<const char*>(data);
+    while (bytes > 0) {
+        ssize_t n = ::send(fd, p, bytes, MSG_NOSIGNAL);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) return false;
+        p += n;
+        bytes -= size_t(n);
+    }
+    return true;
+}
+
+inline bool recvAll(int fd, void* data, size_t bytes) {
+    char* p = static_cast<char*>(data);
+    while (bytes > 0) {
+        ssize_t n = ::recv(fd, p, bytes, 0);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) return false;
+        p += n;
+        bytes -= size_t(n);
+    }
+    return true;
+}
+
+inline bool sendMessage(int fd, uint32_t type, const void* payload, uint32_t length) {
+    uint32_t head[2] = { type, length };
+    return sendAll(fd, head, sizeof(head)) && (length == 0 || sendAll(fd, payload, length));
+}
+
+// Blocking read of one framed message; fails on a payload over maxBytes.
+inline bool recvMessage(int fd, uint32_t& type, std::vector<char>& payload, uint32_t maxBytes = UINT32_MAX) {
+    uint32_t head[2];
+    if (!recvAll(fd, head, sizeof(head)) || head[1] > maxBytes) return false;
+    type = head[0];
+    payload.resize(head[1]);
+    return head[1] == 0 || recvAll(fd, payload.data(), head[1]);
+}
+
+// Incremental framing for non-blocking readers: append what recv() returned,
+// then pop complete messages.
+struct MessageBuffer {
+    std::vector<char> data;
+
+    // Reads what is available; false on EOF or error.
+    bool fill(int fd) {
+        char chunk[65536];
+        for (;;) {
+            ssize_t n = ::recv(fd, chunk, sizeof(chunk), MSG_DONTWAIT);
+            if (n > 0) { data.insert(data.end(), chunk, chunk + n); continue; }
+            if (n == 0) return false;
+            if (errno == EINTR) continue;
+            return errno == EAGAIN || errno == EWOULDBLOCK;
+        }
+    }
+    bool pop(uint32_t& type, std::vector<char>& payload) {
+        if (data.size() < 8) return false;
+        uint32_t head[2];
+        std::memcpy(head, data.data(), 8);
+        if (data.size() < 8 + size_t(head[1])) return false;
+        type = head[0];
+        payload.assign(data.begin() + 8, data.begin() + 8 + head[1]);
+        data.erase(data.begin(), data.begin() + 8 + head[1]);
+        return true;
+    }
+};
@@ -0,0 +1,341 @@
+// Parameter sweeps over mass, observer distance, inclination and disk radii,
+// rendering stills or line profiles into one indexed store (sweep_store.h).
+//
+// Work is shared at every level the physics allows. Everything is computed in
+// units of rs, so the mass only rescales results: grid points that differ in
+// mass alone share one record. A deflection table depends only on the
+// distance, so one per distance serves every inclination and disk. A view's
+// disk crossings (ViewCrossings) depend on the distance and inclination, so
+// one per pair serves every disk annulus, each of which is then a scan of
+// them instead of a trace. The sweep's cost grows with the distinct distances
+// and views, not with the size of the grid.
+//
+//   BlackHoleSweep --task line --mass 4e36,8e36 --distance 50,100,1000
+//                  --inclination 10:80:8 --r-in 3,6 --r-out 20:60:5 --out sweep.bhs
+//
+// Lists are "a,b,c" or "from:to:count". Distances and radii are in
+// Schwarzschild radii, masses in kg, inclinations in degrees. A killed sweep
+// picks up where it stopped when run again with the same --out; --table-dir
+// keeps deflection tables on disk between sweeps. --list prints the index of
+// a finished store and --extract N --to file writes grid point N's result.
+#include "geodesic_core.h"
+#include "observer.h"
+#include "deflection_table.h"
+#include "emission_tables.h"
+#include "disk_shading.h"
+#include "sweep_store.h"
+#include "parallel.h"
+#include "cli_args.h"
+#include "image_io.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+using namespace std;
+using Clock = std::chrono::high_resolution_clock;
+
+// "a,b,c" or "from:to:count"; anything left over after the values is an error
+static bool parseValues(const string& text, vector<double>& out) {
+    const long long MAX_COUNT = 100000;
+    out.clear();
+    if (std::count(text.begin(), text.end(), ':') == 2) {
+        istringstream in(text);
+        double from, to;
+        long long n;
+        char c1 = 0, c2 = 0, extra;
+        if (!(in >> from >> c1 >> to >> c2 >> n) || c1 != ':' || c2 != ':' || in >> extra) return false;
+        if (!std::isfinite(from) || !std::isfinite(to) || n < 1 || n > MAX_COUNT) return false;
+        for (long long i = 0; i < n; ++i) out.push_back(n == 1 ? from : from + (to - from) * double(i) / double(n - 1));
+    } else {
+        for (size_t at = 0; at <= text.size();) {
+            size_t comma = std::min(text.find(',', at), text.size());
+            string item = text.substr(at, comma - at);
+            char* endp = nullptr;
+            double v = std::strtod(item.c_str(), &endp);
+            if (item.empty() || *endp != '\0' || !std::isfinite(v)) return false;
+            out.push_back(v);
+            at = comma + 1;
+        }
+    }
+    std::sort(out.begin(), out.end());
+    out.erase(std::unique(out.begin(), out.end()), out.end());
+    return !out.empty();
+}
+
+static int listStore(const CliArgs& args, const string& path) {
+    vector<SweepPoint> points;
+    string error;
+    if (!SweepStore::readIndex(path, points, error)) {
+        cerr << error << "\n";
+        return EXIT_FAILURE;
+    }
+    if (args.has("extract")) {
+        long long n = args.integer("extract", 0);
+        if (n < 0 || size_t(n) >= points.size()) {
+            cerr << "--extract needs a grid point below " << points.size() << "\n";
+            return EXIT_FAILURE;
+        }
+        SweepRecord rec;
+        vector<unsigned char> payload;
+        if (!SweepStore::readRecord(path, points[n].record, rec, payload)) {
+            cerr << "Cannot read the record of grid point " << n << "\n";
+            return EXIT_FAILURE;
+        }
+        string to = args.str("to", rec.task == SWEEP_RENDER ? "point.ppm" : "point.csv");
+        bool ok;
+        if (rec.task == SWEEP_RENDER) {
+            ok = writePPM(to, int(rec.width), int(rec.height), payload.data());
+        } else {
+            const float* h = reinterpret_cast<const float*>(payload.data());
+            double dg = (rec.gMax - rec.gMin) / rec.width;
+            ofstream csv(to);
+            csv << "g,energy_flux,photon_flux\n";
+            for (uint32_t b = 0; b < rec.width; ++b)
+                csv << rec.gMin + (b + 0.5) * dg << "," << h[b] << "," << h[rec.width + b] << "\n";
+            ok = bool(csv);
+        }
+        if (!ok) {
+            cerr << "Failed to write " << to << "\n";
+            return EXIT_FAILURE;
+        }
+        cout << "[INFO] Grid point " << n << " written to " << to << "\n";
+        return 0;
+    }
+    cout << "point,mass_kg,rs_m,distance_rs,inclination_deg,r_in_rs,r_out_rs,key,record\n";
+    cout.precision(10);
+    for (size_t i = 0; i < points.size(); ++i) {
+        const SweepPoint& p = points[i];
+        cout << i << "," << p.mass << "," << p.rs << "," << p.distance << "," << p.inclination << ","
+             << p.rIn << "," << p.rOut << "," << p.key << "," << p.record << "\n";
+    }
+    return 0;
+}
+
+int main(int argc, char** argv) {
+    CliArgs args(argc, argv);
+    const string out = args.str("out", "sweep.bhs");
+    if (args.has("list") || args.has("extract")) return listStore(args, out);
+
+    const string task = args.str("task", "render");
+    if (task != "render" && task != "line") {
+        cerr << "--task is render or line\n";
+        return EXIT_FAILURE;
+    }
+    const bool line = task == "line";
+    vector<double> masses, distances, inclinations, rIns, rOuts;
+    if (!parseValues(args.str("mass", to_string(SAGA_MASS)), masses)
+        || !parseValues(args.str("distance", "1000"), distances)
+        || !parseValues(args.str("inclination", "60"), inclinations)
+        || !parseValues(args.str("r-in", "3"), rIns)
+        || !parseValues(args.str("r-out", "20"), rOuts)) {
+        cerr << "Parameter lists are \"a,b,c\" or \"from:to:count\"\n";
+        return EXIT_FAILURE;
+    }
+    const int W = int(line ? args.integer("res", 256) : args.integer("width", 256));
+    const int H = int(line ? args.integer("res", 256) : args.integer("height", 256));
+    const int nBins = int(args.integer("bins", 2000));
+    const double gMin = args.num("gmin", 0.1), gMax = args.num("gmax", 1.7);
+    const double q = args.num("q", 3.0);
+    const double tMax = args.num("t-max", 1.5e4);
+    ShadeParams sp;
+    sp.exposure = args.num("exposure", 1.5);
+    const int tableRays = int(args.integer("table-rays", 2048));
+    const int tablePhi = int(args.integer("table-phi", 2048));
+    const string tableDir = args.str("table-dir", "");
+    // every view frames the widest disk of the sweep, so disks at one view share it
+    const double frame = args.num("frame", rOuts.back());
+
+    struct Disk { double rIn, rOut; };
+    vector<Disk> disks;
+    for (double a : rIns)
+        for (double b : rOuts)
+            if (a < b) disks.push_back({ a, b });
+    if (disks.empty() || W < 1 || H < 1 || nBins < 1 || distances.front() <= 1.5) {
+        cerr << "Need some --r-in below --r-out, distances outside the photon sphere and a positive size\n";
+        return EXIT_FAILURE;
+    }
+    if (disks.size() < rIns.size() * rOuts.size())
+        cout << "[INFO] Skipping " << rIns.size() * rOuts.size() - disks.size() << " disks with r-in >= r-out\n";
+
+    SweepStore store;
+    string error;
+    uint64_t dropped = 0;
+    if (!store.open(out, error, &dropped)) {
+        cerr << error << "\n";
+        return EXIT_FAILURE;
+    }
+    if (store.size() || dropped)
+        cout << "[INFO] Resuming " << out << ": " << store.size() << " results kept, "
+             << dropped << " bytes of old index and unfinished records dropped\n";
+
+    auto escapeFor = [&](double d) { return std::max(2.0 * frame, 1.01 * d); };
+    auto fovFor = [&](double d) {
+        return args.has("fov") ? args.num("fov", 60.0) : 2.0 * std::atan(1.15 * frame / d) * 180.0 / GEO_PI;
+    };
+    // what a record depends on besides its distance, inclination and disk
+    uint64_t settings = hashValue(uint32_t(line ? SWEEP_LINE : SWEEP_RENDER), 1469598103934665603ull);
+    for (double v : { double(W), double(H), frame, double(tableRays), double(tablePhi),
+                      args.has("fov") ? args.num("fov", 60.0) : -1.0 })
+        settings = hashValue(v, settings);
+    for (double v : line ? vector<double>{ double(nBins), gMin, gMax, q } : vector<double>{ tMax, sp.exposure })
+        settings = hashValue(v, settings);
+    auto keyOf = [&](double d, double incl, const Disk& k) {
+        uint64_t h = settings;
+        for (double v : { d, incl, k.rIn, k.rOut }) h = hashValue(v, h);
+        return h;
+    };
+
+    ThreadPool& pool = defaultPool();
+    size_t computed = 0, tablesBuilt = 0, tablesLoaded = 0, views = 0;
+    double tableSecs = 0.0, viewSecs = 0.0, resultSecs = 0.0;
+    vector<unsigned char> rgb;
+    vector<EmissionTables> emission(disks.size());   // per disk, in units of rs; built when first needed
+    vector<vector<double>> energyHist(pool.size()), photonHist(pool.size());
+    const double dg = (gMax - gMin) / nBins;
+    auto t0 = Clock::now();
+
+    for (double d : distances) {
+        bool needTable = false;
+        for (double incl : inclinations)
+            for (const Disk& k : disks) needTable = needTable || !store.find(keyOf(d, incl, k));
+        if (!needTable) continue;
+
+        auto ta = Clock::now();
+        const double escapeRs = escapeFor(d);
+        DeflectionTable table;
+        string cachePath;
+        if (!tableDir.empty()) {
+            char name[96];
+            snprintf(name, sizeof(name), "/deflection_%.9g_%.9g_%d_%d.bin", d, escapeRs, tableRays, tablePhi);
+            cachePath = tableDir + name;
+        }
+        if (!cachePath.empty() && table.load(cachePath) && table.matches(d, escapeRs)) {
+            tablesLoaded++;
+        } else {
+            table = DeflectionTable::build(d, escapeRs, tableRays, tablePhi, pool);
+            tablesBuilt++;
+            if (!cachePath.empty() && !table.save(cachePath))
+                cerr << "[WARN] Could not write deflection cache " << cachePath << "\n";
+        }
+        tableSecs += chrono::duration<double>(Clock::now() - ta).count();
+
+        for (double incl : inclinations) {
+            bool needView = false;
+            for (const Disk& k : disks) needView = needView || !store.find(keyOf(d, incl, k));
+            if (!needView) continue;
+
+            auto tv = Clock::now();
+            ObserverView view = ObserverView::orbit(d, 0.0, incl * GEO_PI / 180.0, fovFor(d), double(W) / H);
+            ViewCrossings vc = ViewCrossings::build(table, view, W, H, pool);
+            views++;
+            viewSecs += chrono::duration<double>(Clock::now() - tv).count();
+
+            auto tr = Clock::now();
+            for (size_t di = 0; di < disks.size(); ++di) {
+                const Disk& k = disks[di];
+                uint64_t key = keyOf(d, incl, k);
+                if (store.find(key)) continue;
+                SweepRecord rec{};
+                rec.task = line ? SWEEP_LINE : SWEEP_RENDER;
+                rec.key = key;
+                rec.distance = d;
+                rec.inclination = incl;
+                rec.rIn = k.rIn;
+                rec.rOut = k.rOut;
+                uint64_t at;
+                if (!line) {
+                    EmissionTables& em = emission[di];
+                    if (em.flux.empty()) {
+                        if (di > 0 && !emission[0].blackbodyRGB.empty()) {
+                            em = emission[0];   // the blackbody table does not depend on the disk
+                            em.rIn = float(k.rIn);
+                            em.rOut = float(k.rOut);
+                            em.buildFlux();
+                        } else {
+                            em = EmissionTables::build(k.rIn, k.rOut, 1.0, tMax);
+                        }
+                    }
+                    rgb.resize(size_t(W) * H * 3);
+                    pool.parallelFor(0, size_t(W) * H, 4096, [&](size_t i0, size_t i1, unsigned) {
+                        for (size_t i = i0; i < i1; ++i)
+                            storeRGB8(shadeSample(vc.sample(i, 1.0, k.rIn, k.rOut), em, sp), &rgb[3 * i]);
+                    });
+                    rec.width = uint32_t(W);
+                    rec.height = uint32_t(H);
+                    at = store.append(rec, rgb.data(), rgb.size());
+                } else {
+                    // as line_profile.cpp: photon flux ∝ g³ ε dΩ, energy flux ∝ g⁴ ε dΩ, ε = r^-q
+                    const double du = 2.0 * view.aspect * view.tanHalfFov / W;
+                    const double dv = 2.0 * view.tanHalfFov / H;
+                    pool.parallelFor(0, size_t(H), 2, [&](size_t y0, size_t y1, unsigned slot) {
+                        vector<double>& eh = energyHist[slot];
+                        vector<double>& ph = photonHist[slot];
+                        eh.resize(nBins);
+                        ph.resize(nBins);
+                        for (size_t y = y0; y < y1; ++y)
+                            for (int x = 0; x < W; ++x) {
+                                GSample s = vc.sample(y * W + x, 1.0, k.rIn, k.rOut);
+                                int b = int(std::floor((s.g - gMin) / dg));
+                                if (s.kind != GSampleKind::Disk || s.g <= 0.0f || b < 0 || b >= nBins) continue;
+                                double u = (2.0 * (x + 0.5) / W - 1.0) * view.aspect * view.tanHalfFov;
+                                double v = (1.0 - 2.0 * (y + 0.5) / H) * view.tanHalfFov;
+                                double qq = 1.0 + u*u + v*v;
+                                double eps = std::pow(double(s.r), -q) * du * dv / (qq * std::sqrt(qq));
+                                double g3 = double(s.g) * s.g * s.g;
+                                ph[b] += eps * g3;
+                                eh[b] += eps * g3 * s.g;
+                            }
+                    });
+                    vector<float> hist(2 * size_t(nBins), 0.0f);
+                    for (unsigned sl = 0; sl < pool.size(); ++sl)
+                        for (int b = 0; b < nBins && !energyHist[sl].empty(); ++b) {
+                            hist[b] += float(energyHist[sl][b] / dg);
+                            hist[nBins + b] += float(photonHist[sl][b] / dg);
+                            energyHist[sl][b] = photonHist[sl][b] = 0.0;
+                        }
+                    rec.width = uint32_t(nBins);
+                    rec.height = 2;
+                    rec.gMin = gMin;
+                    rec.gMax = gMax;
+                    rec.q = q;
+                    at = store.append(rec, hist.data(), hist.size() * sizeof(float));
+                }
+                if (!at) {
+                    cerr << "Failed to append to " << out << "\n";
+                    return EXIT_FAILURE;
+                }
+                computed++;
+            }
+            resultSecs += chrono::duration<double>(Clock::now() - tr).count();
+        }
+    }
+
+    vector<SweepPoint> points;
+    for (double m : masses)
+        for (double d : distances)
+            for (double incl : inclinations)
+                for (const Disk& k : disks) {
+                    SweepPoint p{ m, schwarzschildRadius(m), d, incl, k.rIn, k.rOut, keyOf(d, incl, k), 0 };
+                    p.record = store.find(p.key);
+                    points.push_back(p);
+                }
+    if (!store.finish(points)) {
+        cerr << "Failed to write the index of " << out << "\n";
+        return EXIT_FAILURE;
+    }
+    double secs = chrono::duration<double>(Clock::now() - t0).count();
+    const size_t unique = distances.size() * inclinations.size() * disks.size();
+    cout << "[INFO] Sweep of " << points.size() << " grid points (" << unique << " distinct in units of rs) in "
+         << secs << " s, indexed in " << out << "\n"
+         << "[INFO]   " << computed << " " << task << " results computed, " << unique - computed
+         << " already stored\n"
+         << "[INFO]   " << tablesBuilt << " deflection tables built, " << tablesLoaded << " loaded ("
+         << tableSecs << " s); " << views << " views of disk crossings (" << viewSecs << " s); results "
+         << resultSecs << " s\n";
+    return 0;
+}
@@ -0,0 +1,193 @@
+#pragma once
+// Indexed result store for parameter sweeps.
+//
+// One file ("BHSWP002", host byte order, checked on open): a 16-byte header,
+// then records appended as results finish, each a 96-byte SweepRecord and its
+// payload, and after the last one an index with a SweepPoint per grid point
+// followed by a SweepFooter that points at it. Grid points whose results coincide (in units
+// of rs a sweep over mass changes nothing) share one record through its key.
+//
+// A sweep that was killed leaves no index. Opening the file again scans the
+// records, cuts off a torn last one and any old index, and appending carries
+// on from there, so finished results are never computed twice; finish()
+// writes the new index.
+#include "checkpoint.h"
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+enum SweepTask : uint32_t { SWEEP_RENDER = 1, SWEEP_LINE = 2 };
+
+struct SweepRecord {
+    char tag[4];              // "REC1"
+    uint32_t task;            // SweepTask
+    uint64_t key;             // hash of everything the payload depends on
+    uint64_t bytes;           // payload size
+    uint32_t width, height;   // RGB8 width × height, or bins × 2 floats (energy, photon flux)
+    double distance, inclination, rIn, rOut;   // units of rs, inclination in degrees
+    double gMin, gMax, q;     // line records: the g axis of the bins and the emissivity index
+    double reserved;
+};
+static_assert(sizeof(SweepRecord) == 96, "sweep record layout is part of the file format");
+
+struct SweepPoint {
+    double mass, rs;          // kg, m
+    double distance, inclination, rIn, rOut;   // as in SweepRecord
+    uint64_t key;
+    uint64_t record;          // file offset of the SweepRecord holding the result
+};
+static_assert(sizeof(SweepPoint) == 64, "sweep index layout is part of the file format");
+
+struct SweepFooter {
+    char magic[8];            // "BHSIDX01"
+    uint64_t index;           // file offset of the first SweepPoint
+    uint64_t points;
+};
+
+class SweepStore {
+public:
+    static constexpr uint64_t HEADER_BYTES = 16;
+
+    SweepStore() = default;
+    SweepStore(const SweepStore&) = delete;
+    SweepStore& operator=(const SweepStore&) = delete;
+    ~SweepStore() { close(); }
+
+    // Opens path for appending, creating it if needed. dropped counts the
+    // bytes of torn records and old index cut off the end.
+    bool open(const std::string& path, std::string& error, uint64_t* dropped = nullptr) {
+        close();
+        if (!fileExists(path)) {
+            file = std::fopen(path.c_str(), "w+b");
+            if (!file) { error = "cannot create " + path; return false; }
+            char head[HEADER_BYTES] = { 'B','H','S','W','P','0','0','2' };
+            const uint32_t order = 0x01020304u;
+            std::memcpy(head + 8, &order, 4);
+            end = HEADER_BYTES;
+            if (std::fwrite(head, 1, HEADER_BYTES, file) != HEADER_BYTES || std::fflush(file) != 0)
+                return fail("cannot write " + path, error);
+            return true;
+        }
+        uint64_t size = std::filesystem::file_size(path);
+        file = std::fopen(path.c_str(), "r+b");
+        if (!file) { error = "cannot open " + path; return false; }
+        char head[HEADER_BYTES];
+        uint32_t order;
+        if (std::fread(head, 1, HEADER_BYTES, file) != HEADER_BYTES || std::memcmp(head, "BHSWP", 5) != 0)
+            return fail(path + " is not a sweep store", error);
+        if (std::memcmp(head, "BHSWP002", 8) != 0) return fail("unsupported sweep store version", error);
+        std::memcpy(&order, head + 8, 4);
+        if (order != 0x01020304u) return fail("written with the other byte order", error);
+
+        end = HEADER_BYTES;
+        SweepRecord rec;
+        while (end + sizeof(rec) <= size && seek(end) && std::fread(&rec, sizeof(rec), 1, file) == 1
+               && std::memcmp(rec.tag, "REC1", 4) == 0 && rec.bytes <= size - end - sizeof(rec)) {
+            records[rec.key] = end;
+            end += sizeof(rec) + rec.bytes;
+        }
+        if (dropped) *dropped = size - end;
+        if (end < size) {
+            std::fclose(file);
+            file = nullptr;
+            std::error_code ec;
+            std::filesystem::resize_file(path, end, ec);
+            if (ec || !(file = std::fopen(path.c_str(), "r+b"))) return fail("cannot truncate " + path, error);
+        }
+        return true;
+    }
+
+    void close() {
+        if (file) std::fclose(file);
+        file = nullptr;
+        records.clear();
+    }
+
+    // Offset of the record with this key, or 0.
+    uint64_t find(uint64_t key) const {
+        auto it = records.find(key);
+        return it == records.end() ? 0 : it->second;
+    }
+    size_t size() const { return records.size(); }
+
+    // Appends rec and its payload; returns the record's offset, 0 on failure.
+    uint64_t append(SweepRecord rec, const void* payload, size_t bytes) {
+        std::memcpy(rec.tag, "REC1", 4);
+        rec.bytes = bytes;
+        uint64_t at = end;
+        if (!seek(at) || std::fwrite(&rec, sizeof(rec), 1, file) != 1
+            || std::fwrite(payload, 1, bytes, file) != bytes || std::fflush(file) != 0)
+            return 0;
+        end += sizeof(rec) + bytes;
+        records[rec.key] = at;
+        return at;
+    }
+
+    // Writes the index after the last record. Appending afterwards replaces it.
+    bool finish(const std::vector<SweepPoint>& points) {
+        SweepFooter foot;
+        std::memcpy(foot.magic, "BHSIDX01", 8);
+        foot.index = end;
+        foot.points = points.size();
+        return seek(end) && std::fwrite(points.data(), sizeof(SweepPoint), points.size(), file) == points.size()
+            && std::fwrite(&foot, sizeof(foot), 1, file) == 1 && std::fflush(file) == 0;
+    }
+
+    // -- reading a finished store -- //
+    static bool readIndex(const std::string& path, std::vector<SweepPoint>& points, std::string& error) {
+        FILE* f = std::fopen(path.c_str(), "rb");
+        if (!f) { error = "cannot open " + path; return false; }
+        SweepFooter foot;
+        char magic[8];
+        bool ok = std::fread(magic, 1, 8, f) == 8 && std::memcmp(magic, "BHSWP002", 8) == 0
+               && std::fseek(f, -long(sizeof(foot)), SEEK_END) == 0
+               && std::fread(&foot, sizeof(foot), 1, f) == 1 && std::memcmp(foot.magic, "BHSIDX01", 8) == 0;
+        if (!ok) error = path + " has no index (not a sweep store, or the sweep did not finish)";
+        if (ok) {
+            // the index sits between the header and the footer; bound it before allocating
+            std::error_code ec;
+            uint64_t size = std::filesystem::file_size(path, ec);
+            ok = !ec && foot.index >= HEADER_BYTES && foot.index <= size - sizeof(foot)
+              && foot.points <= (size - sizeof(foot) - foot.index) / sizeof(SweepPoint);
+            if (ok) points.resize(foot.points);
+            ok = ok && std::fseek(f, long(foot.index), SEEK_SET) == 0
+              && std::fread(points.data(), sizeof(SweepPoint), points.size(), f) == points.size();
+            if (!ok) error = "truncated index in " + path;
+        }
+        std::fclose(f);
+        return ok;
+    }
+
+    static bool readRecord(const std::string& path, uint64_t offset, SweepRecord& rec,
+                           std::vector<unsigned char>& payload) {
+        FILE* f = std::fopen(path.c_str(), "rb");
+        if (!f) return false;
+        bool ok = std::fseek(f, long(offset), SEEK_SET) == 0 && std::fread(&rec, sizeof(rec), 1, f) == 1
+               && std::memcmp(rec.tag, "REC1", 4) == 0;
+        if (ok) {
+            std::error_code ec;
+            uint64_t size = std::filesystem::file_size(path, ec);
+            ok = !ec && rec.bytes <= size - offset - sizeof(rec);   // the fread above put offset + rec inside
+            if (ok) payload.resize(rec.bytes);
+            ok = ok && std::fread(payload.data(), 1, payload.size(), f) == payload.size();
+        }
+        std::fclose(f);
+        return ok;
+    }
+
+private:
+    bool seek(uint64_t at) { return std::fseek(file, long(at), SEEK_SET) == 0; }
+    bool fail(const std::string& why, std::string& error) {
+        error = why;
+        close();
+        return false;
+    }
+
+    FILE* file = nullptr;
+    uint64_t end = 0;                                  // where the next record goes
+    std::unordered_map<uint64_t, uint64_t> records;    // key → offset
+};
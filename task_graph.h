@@ -0,0 +1,126 @@
+#pragma once
+// Dependency graph of per-frame tasks, declared once and run every frame.
+//
+// Pool tasks run on a ThreadPool as soon as their dependencies finish;
+// caller tasks run on the thread that calls run() — the one owning the GL
+// context — in the order they become ready. A frame then takes as long as
+// its critical path instead of the sum of its stages.
+//
+// Pool tasks run inside a FrameArena::Scope of their worker's arena, so
+// FrameVector scratch in them is released when they return; anything a later
+// task reads must live elsewhere.
+#include "frame_arena.h"
+#include "parallel.h"
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <vector>
+
+class TaskGraph {
+public:
+    enum class On { Pool, Caller };
+
+    // Tasks may only depend on tasks added before them.
+    int add(std::string name, std::function<void()> fn, std::vector<int> deps = {}, On where = On::Pool) {
+        int id = int(tasks.size());
+        for (int d : deps) tasks[d].dependents.push_back(id);
+        tasks.push_back({ std::move(name), std::move(fn), where, std::move(deps), {}, 0.0, 0.0, 0.0 });
+        return id;
+    }
+
+    // Runs every task once and returns when all have finished.
+    void run(ThreadPool& pool = defaultPool()) {
+        start = Clock::now();
+        remaining.assign(tasks.size(), 0);
+        for (size_t i = 0; i < tasks.size(); ++i) remaining[i] = int(tasks[i].deps.size());
+        unfinished = tasks.size();
+        for (size_t i = 0; i < tasks.size(); ++i)
+            if (tasks[i].deps.empty()) schedule(int(i), pool);
+
+        std::unique_lock<std::mutex> lock(mtx);
+        while (unfinished > 0) {
+            if (callerReady.empty()) { cv.wait(lock); continue; }
+            int id = callerReady.front();
+            callerReady.pop_front();
+            lock.unlock();
+            execute(id, pool);
+            lock.lock();
+        }
+    }
+
+    // Timings of the last run, in milliseconds.
+    double wallMs() const {
+        double end = 0.0;
+        for (const Task& t : tasks) end = std::max(end, t.endMs);
+        return end;
+    }
+    double sumMs() const {
+        double sum = 0.0;
+        for (const Task& t : tasks) sum += t.endMs - t.beginMs;
+        return sum;
+    }
+    // Longest chain of task durations through the dependencies.
+    double criticalPathMs() const {
+        double longest = 0.0;
+        for (const Task& t : tasks) longest = std::max(longest, t.pathMs);
+        return longest;
+    }
+    size_t size() const { return tasks.size(); }
+    const std::string& name(int id) const { return tasks[id].name; }
+    double taskMs(int id) const { return tasks[id].endMs - tasks[id].beginMs; }
+
+private:
+    using Clock = std::chrono::steady_clock;
+    struct Task {
+        std::string name;
+        std::function<void()> fn;
+        On where;
+        std::vector<int> deps, dependents;
+        double beginMs, endMs, pathMs;
+    };
+
+    double sinceStart() const { return std::chrono::duration<double, std::milli>(Clock::now() - start).count(); }
+
+    void schedule(int id, ThreadPool& pool) {
+        if (tasks[id].where == On::Pool) {
+            pool.submit([this, id, &pool] {
+                FrameArena::Scope scratch(threadFrameArena());
+                execute(id, pool);
+            });
+        } else {
+            std::lock_guard<std::mutex> lock(mtx);
+            callerReady.push_back(id);
+            cv.notify_all();
+        }
+    }
+
+    void execute(int id, ThreadPool& pool) {
+        Task& t = tasks[id];
+        t.beginMs = sinceStart();
+        t.fn();
+        t.endMs = sinceStart();
+        FrameVector<int> ready;   // from the running thread's arena
+        {
+            std::lock_guard<std::mutex> lock(mtx);
+            double before = 0.0;
+            for (int d : t.deps) before = std::max(before, tasks[d].pathMs);
+            t.pathMs = before + (t.endMs - t.beginMs);
+            for (int d : t.dependents)
+                if (--remaining[d] == 0) ready.push_back(d);
+        }
+        for (int d : ready) schedule(d, pool);
+        std::lock_guard<std::mutex> lock(mtx);
+        if (--unfinished == 0) cv.notify_all();
+    }
+
+    std::vector<Task> tasks;
+    std::vector<int> remaining;
+    size_t unfinished = 0;
+    std::deque<int> callerReady;
+    std::mutex mtx;
+    std::condition_variable cv;
+    Clock::time_point start;
+};
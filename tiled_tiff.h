@@ -0,0 +1,250 @@
+#pragma once
+// Streaming tiled TIFF writer for images too large to hold in memory.
+//
+// Tiles are queued from any thread and appended to the file by a background
+// writer in arrival order; only their offsets are remembered. close() writes
+// one IFD per level, so a file with several levels is a multi-resolution
+// pyramid (levels after the first are flagged as reduced-resolution images,
+// which is what pyramid viewers and libvips/OpenSlide-style readers expect).
+// Files whose data would pass 4 GiB are written as BigTIFF.
+//
+// Every tile is tile × tile pixels, chunky, uncompressed, rows top-down;
+// edge tiles are padded. Samples are 8-bit or 32-bit float in host byte
+// order, which must be little-endian ("II").
+#include "image_io.h"
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <cstdio>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+struct TiffLevel {
+    uint32_t width = 0, height = 0;
+};
+
+class TiledTiffWriter {
+public:
+    // tile must be a multiple of 16 (TIFF requirement for tiled images).
+    TiledTiffWriter(const std::string& path, std::vector<TiffLevel> levels, uint32_t tile, int channels,
+                    bool floatSamples, const std::string& description = "", bool forceBig = false)
+        : levels(std::move(levels)), tile(tile), channels(channels), floatSamples(floatSamples),
+          description(description) {
+        if (tile == 0 || tile % 16 != 0 || this->levels.empty()) return;   // tileCount() divides by tile
+        uint64_t tiles = 0;
+        for (size_t l = 0; l < this->levels.size(); ++l) {
+            tiles += tileCount(int(l));
+            offsets.emplace_back(tileCount(int(l)), 0);
+        }
+        uint64_t total = tiles * tileBytes() + tiles * 8 + description.size() + 4096 * this->levels.size();
+        big = forceBig || total > 0xffffffffull;
+        file = std::fopen(path.c_str(), "wb");
+        if (!file) return;
+        std::vector<unsigned char> head = { 'I', 'I' };
+        if (big) {
+            tiffPut16(head, 43);
+            tiffPut16(head, 8);
+            tiffPut16(head, 0);
+            put64(head, 0);     // first IFD, patched by close()
+        } else {
+            tiffPut16(head, 42);
+            tiffPut32(head, 0);
+        }
+        if (std::fwrite(head.data(), 1, head.size(), file) != head.size()) {
+            std::fclose(file);
+            file = nullptr;
+            return;
+        }
+        fileSize = head.size();
+        writer = std::thread([this] { writerLoop(); });
+    }
+    ~TiledTiffWriter() { close(); }
+    TiledTiffWriter(const TiledTiffWriter&) = delete;
+    TiledTiffWriter& operator=(const TiledTiffWriter&) = delete;
+
+    bool ok() const { return file != nullptr && !failed; }
+    bool bigTiff() const { return big; }
+    uint32_t tilesAcross(int level) const { return (levels[level].width + tile - 1) / tile; }
+    uint32_t tilesDown(int level) const { return (levels[level].height + tile - 1) / tile; }
+    size_t tileCount(int level) const { return size_t(tilesAcross(level)) * tilesDown(level); }
+    size_t tileBytes() const { return size_t(tile) * tile * channels * (floatSamples ? 4 : 1); }
+
+    // Queues tile (tx, ty) of a level; data holds tileBytes(). Blocks while
+    // MAX_QUEUED tiles are waiting, so memory stays bounded when the disk is
+    // slower than the renderer.
+    void write(int level, uint32_t tx, uint32_t ty, std::vector<unsigned char> data) {
+        if (!file) return;
+        std::unique_lock<std::mutex> lock(mtx);
+        spaceCv.wait(lock, [&] { return queue.size() < MAX_QUEUED || stopping; });
+        queue.push_back({ level, size_t(ty) * tilesAcross(level) + tx, std::move(data) });
+        cv.notify_one();
+    }
+
+    // Drains the queue and writes the directories; tiles never written read as empty.
+    bool close() {
+        if (!file) return false;
+        {
+            std::lock_guard<std::mutex> lock(mtx);
+            stopping = true;
+        }
+        cv.notify_all();
+        writer.join();
+
+        // lay out every level's out-of-line values followed by its IFD, then write them in order
+        std::vector<std::vector<Field>> dirs;
+        std::vector<uint64_t> ifdPos;
+        uint64_t pos = fileSize;
+        for (size_t l = 0; l < levels.size(); ++l) {
+            dirs.push_back(fields(int(l)));
+            for (Field& f : dirs.back())
+                if (f.data.size() > inlineBytes()) {
+                    pos += pos & 1;
+                    f.offset = pos;
+                    pos += f.data.size();
+                }
+            pos += pos & 1;
+            ifdPos.push_back(pos);
+            pos += big ? 8 + 20 * dirs.back().size() + 8 : 2 + 12 * dirs.back().size() + 4;
+        }
+        std::vector<unsigned char> b;
+        for (size_t l = 0; l < levels.size(); ++l) {
+            for (const Field& f : dirs[l])
+                if (f.data.size() > inlineBytes()) {
+                    if ((fileSize + b.size()) & 1) b.push_back(0);
+                    b.insert(b.end(), f.data.begin(), f.data.end());
+                }
+            if ((fileSize + b.size()) & 1) b.push_back(0);
+            big ? put64(b, dirs[l].size()) : tiffPut16(b, uint16_t(dirs[l].size()));
+            for (const Field& f : dirs[l]) {
+                tiffPut16(b, f.tag);
+                tiffPut16(b, f.type);
+                big ? put64(b, f.count) : tiffPut32(b, uint32_t(f.count));
+                std::vector<unsigned char> value = f.data;
+                if (value.size() > inlineBytes()) {
+                    value.clear();
+                    big ? put64(value, f.offset) : tiffPut32(value, uint32_t(f.offset));
+                }
+                value.resize(inlineBytes(), 0);
+                b.insert(b.end(), value.begin(), value.end());
+            }
+            uint64_t next = l + 1 < levels.size() ? ifdPos[l + 1] : 0;
+            big ? put64(b, next) : tiffPut32(b, uint32_t(next));
+        }
+        bool good = std::fwrite(b.data(), 1, b.size(), file) == b.size();
+
+        std::vector<unsigned char> first;
+        big ? put64(first, ifdPos[0]) : tiffPut32(first, uint32_t(ifdPos[0]));
+        good = good && std::fseek(file, big ? 8 : 4, SEEK_SET) == 0
+                    && std::fwrite(first.data(), 1, first.size(), file) == first.size();
+        good = std::fclose(file) == 0 && good && !failed;
+        file = nullptr;
+        bytesWritten = fileSize + b.size();
+        return good;
+    }
+
+    std::atomic<uint64_t> bytesWritten{0};
+
+private:
+    struct Pending {
+        int level;
+        size_t index;
+        std::vector<unsigned char> data;
+    };
+    struct Field {
+        uint16_t tag, type;
+        uint64_t count;
+        std::vector<unsigned char> data;   // little-endian values
+        uint64_t offset = 0;               // file position when not inline
+    };
+
+    static void put64(std::vector<unsigned char>& b, uint64_t v) {
+        for (int i = 0; i < 8; ++i) b.push_back((v >> (8 * i)) & 0xff);
+    }
+    size_t inlineBytes() const { return big ? 8 : 4; }
+
+    // Directory entries of one level, sorted by tag.
+    std::vector<Field> fields(int level) const {
+        auto shorts = [](uint16_t tag, uint16_t v, uint64_t n) {
+            Field f{ tag, 3, n, {} };
+            for (uint64_t i = 0; i < n; ++i) tiffPut16(f.data, v);
+            return f;
+        };
+        auto long1 = [](uint16_t tag, uint32_t v) {
+            Field f{ tag, 4, 1, {} };
+            tiffPut32(f.data, v);
+            return f;
+        };
+        // offsets and byte counts are LONG8 in BigTIFF
+        auto array = [&](uint16_t tag, const std::vector<uint64_t>& v) {
+            Field f{ tag, uint16_t(big ? 16 : 4), v.size(), {} };
+            for (uint64_t x : v) big ? put64(f.data, x) : tiffPut32(f.data, uint32_t(x));
+            return f;
+        };
+        const std::vector<uint64_t>& offs = offsets[level];
+        std::vector<uint64_t> counts(offs.size());
+        for (size_t i = 0; i < offs.size(); ++i) counts[i] = offs[i] ? tileBytes() : 0;
+
+        std::vector<Field> e;
+        e.push_back(long1(254, level > 0 ? 1 : 0));                    // NewSubfileType: reduced resolution
+        e.push_back(long1(256, levels[level].width));                  // ImageWidth
+        e.push_back(long1(257, levels[level].height));                 // ImageLength
+        e.push_back(shorts(258, floatSamples ? 32 : 8, channels));     // BitsPerSample
+        e.push_back(shorts(259, 1, 1));                                // Compression: none
+        e.push_back(shorts(262, channels == 3 ? 2 : 1, 1));            // Photometric: RGB or MinIsBlack
+        if (level == 0 && !description.empty()) {
+            Field d{ 270, 2, description.size() + 1, {} };             // ImageDescription
+            d.data.assign(description.begin(), description.end());
+            d.data.push_back(0);
+            e.push_back(d);
+        }
+        e.push_back(shorts(277, uint16_t(channels), 1));               // SamplesPerPixel
+        e.push_back(shorts(284, 1, 1));                                // PlanarConfiguration: chunky
+        e.push_back(long1(322, tile));                                 // TileWidth
+        e.push_back(long1(323, tile));                                 // TileLength
+        e.push_back(array(324, offs));                                 // TileOffsets
+        e.push_back(array(325, counts));                               // TileByteCounts
+        e.push_back(shorts(339, floatSamples ? 3 : 1, channels));      // SampleFormat
+        return e;
+    }
+
+    void writerLoop() {
+        for (;;) {
+            Pending p;
+            {
+                std::unique_lock<std::mutex> lock(mtx);
+                cv.wait(lock, [&] { return stopping || !queue.empty(); });
+                if (queue.empty()) return;
+                p = std::move(queue.front());
+                queue.pop_front();
+            }
+            spaceCv.notify_all();
+            if (std::fwrite(p.data.data(), 1, p.data.size(), file) != p.data.size()) failed = true;
+            offsets[p.level][p.index] = fileSize;
+            fileSize += p.data.size();
+            bytesWritten = fileSize;
+        }
+    }
+
+    static constexpr size_t MAX_QUEUED = 64;
+
+    std::vector<TiffLevel> levels;
+    uint32_t tile;
+    int channels;
+    bool floatSamples;
+    std::string description;
+    bool big = false;
+    FILE* file = nullptr;
+    uint64_t fileSize = 0;
+    std::atomic<bool> failed{false};
+    std::vector<std::vector<uint64_t>> offsets;   // writer thread only until close()
+
+    std::mutex mtx;
+    std::condition_variable cv, spaceCv;
+    bool stopping = false;
+    std::deque<Pending> queue;
+    std::thread writer;
+};
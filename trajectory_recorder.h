@@ -0,0 +1,471 @@
+#pragma once
+// Compact trajectory recording for the CPU tracers.
+//
+// Points go through an online decimator that drops samples lying within
+// tolerance · r of the chord between the points it keeps (r = distance from
+// the hole, so the strong-field part keeps its detail). Kept points are
+// snapped to a grid of `quantum` meters and stored as zigzag varint deltas.
+// Every SEGMENT_POINTS kept points form a self-contained segment (its first
+// point is absolute); segments are packed into chunks that a background
+// thread appends to the file, and an index of (trajectory, segment) → file
+// offset is written as a footer on close. Readers fetch one trajectory
+// without scanning; a file whose footer is missing (killed job) is indexed
+// by walking its chunks.
+//
+// Layout (native byte order):
+//   header   "BHTRJ001", u32 dims, u32 0, f64 quantum
+//   chunk    u32 CHUNK_MAGIC, u32 payload bytes, segments
+//   segment  varint id, seq, points, bytes; then `bytes` of zigzag varints
+//   index    TrajectoryIndexEntry[count]
+//   trailer  u64 index offset, u64 count, "BHTRJIDX"
+#include "geodesic_core.h"
+#include <glm/glm.hpp>
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <condition_variable>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+struct TrajectoryIndexEntry {
+    uint64_t id;
+    uint64_t offset;    // file offset of the segment's point data
+    uint32_t bytes;
+    uint32_t points;
+    uint32_t seq;       // segment number within the trajectory
+    uint32_t reserved;
+};
+
+namespace trajectory_detail {
+constexpr uint32_t CHUNK_MAGIC = 0x4b4e4843;   // "CHNK"
+
+inline void putVarint(std::vector<uint8_t>& out, uint64_t v) {
+    while (v >= 0x80) { out.push_back(uint8_t(v) | 0x80); v >>= 7; }
+    out.push_back(uint8_t(v));
+}
+inline bool getVarint(const uint8_t*& p, const uint8_t* end, uint64_t& v) {
+    v = 0;
+    for (int shift = 0; p < end && shift < 64; shift += 7) {
+        uint8_t b = *p++;
+        v |= uint64_t(b & 0x7f) << shift;
+        if (!(b & 0x80)) return true;
+    }
+    return false;
+}
+inline uint64_t zigzag(int64_t v) { return (uint64_t(v) << 1) ^ uint64_t(v >> 63); }
+inline int64_t unzigzag(uint64_t v) { return int64_t(v >> 1) ^ -int64_t(v & 1); }
+} // namespace trajectory_detail
+
+// Keeps a point only when some dropped point would otherwise stray more than
+// tolerance · |q| (at least minError) from the chord between kept points.
+//
+// O(1) per point: each dropped point q admits the cone of directions from the
+// anchor whose rays pass within its error of q; the decimator keeps a cone
+// inscribed in the intersection of all of them, and a new point extends the
+// chord while its direction stays inside and it lies beyond every dropped one.
+// Cones are carried as (axis, cos, sin) of the half-angle so the per-point
+// work is a handful of square roots and no trigonometry.
+class TrajectoryDecimator {
+public:
+    TrajectoryDecimator(double tolerance, double minError) : tolerance(tolerance), minError(minError) {}
+
+    template <class Emit> void add(const glm::dvec3& p, Emit&& emit) {
+        if (!haveAnchor) {
+            emit(p);
+            anchor = p;
+            haveAnchor = true;
+            cone = Cone();
+            farthest = 0.0;
+            return;
+        }
+        if (haveLast) {
+            // tentatively require the chord to pass near `last` as well
+            Cone next = cone;
+            glm::dvec3 dl = last - anchor;
+            double dist = glm::length(dl);
+            double err = std::max(tolerance * glm::length(last), minError);
+            bool keep = false;
+            if (dist > err) {
+                double sinT = err / dist;
+                keep = !next.intersect(dl / dist, std::sqrt(1.0 - sinT * sinT), sinT);
+            }
+            glm::dvec3 dp = p - anchor;
+            double reach = glm::length(dp);
+            if (!keep) keep = reach < std::max(farthest, dist) || (!next.open && glm::dot(dp, next.axis) < next.c * reach);
+            if (keep) {
+                emit(last);
+                anchor = last;
+                cone = Cone();
+                farthest = 0.0;
+            } else {
+                cone = next;
+                farthest = std::max(farthest, dist);
+            }
+        }
+        last = p;
+        haveLast = true;
+    }
+    template <class Emit> void finish(Emit&& emit) {
+        if (haveLast) emit(last);
+        haveAnchor = haveLast = false;
+    }
+
+private:
+    struct Cone {
+        glm::dvec3 axis{1.0, 0.0, 0.0};
+        double c = -1.0, s = 0.0;   // cos, sin of the half-angle
+        bool open = true;           // no constraint yet
+
+        // Shrinks to a cone inside the intersection with (a, half-angle θ ≤ π/2);
+        // false if they do not overlap.
+        bool intersect(const glm::dvec3& a, double cT, double sT) {
+            if (open) { axis = a; c = cT; s = sT; open = false; return true; }
+            double cd = std::clamp(glm::dot(axis, a), -1.0, 1.0);
+            double sd = std::sqrt(std::max(0.0, 1.0 - cd * cd));
+            double sumC = c * cT - s * sT, sumS = s * cT + c * sT;   // half + θ
+            double difC = c * cT + s * sT, difS = s * cT - c * sT;   // half - θ
+            if (sumS >= 0.0 && cd < sumC) return false;              // δ > half + θ
+            if (difS >= 0.0 && cd >= difC) { axis = a; c = cT; s = sT; return true; }   // a inside
+            if (difS <= 0.0 && cd >= difC) return true;              // already inside a
+            // the lens along the great circle from axis to a spans [δ - θ, half];
+            // centre at (δ - θ + half) / 2, half-width (half + θ - δ) / 2
+            double c2 = cd * difC - sd * difS, s2 = sd * difC + cd * difS;
+            double cc = std::sqrt(std::max(0.0, 0.5 * (1.0 + c2)));
+            double sc = std::sqrt(std::max(0.0, 0.5 * (1.0 - c2)));
+            if (s2 < 0.0) cc = -cc;
+            if (sd > 1e-15) axis = cc * axis + sc * ((a - cd * axis) / sd);
+            double w2 = sumC * cd + sumS * sd;
+            c = std::sqrt(std::max(0.0, 0.5 * (1.0 + w2)));
+            s = std::sqrt(std::max(0.0, 0.5 * (1.0 - w2)));
+            return true;
+        }
+    };
+
+    double tolerance, minError;
+    bool haveAnchor = false, haveLast = false;
+    glm::dvec3 anchor{0.0}, last{0.0};
+    Cone cone;
+    double farthest = 0.0;
+};
+
+class TrajectoryRecorder {
+public:
+    static constexpr uint32_t SEGMENT_POINTS = 4096;
+
+    // One trajectory being recorded; use from one thread at a time and
+    // finish (or destroy) it before the recorder.
+    class Trace {
+    public:
+        Trace() = default;
+        Trace(Trace&& o) noexcept { *this = std::move(o); }
+        Trace& operator=(Trace&& o) noexcept {
+            if (this != &o) {
+                finish();
+                rec = o.rec; id = o.id; seq = o.seq; count = o.count; seen = o.seen;
+                decimator = std::move(o.decimator);
+                data = std::move(o.data);
+                std::memcpy(prev, o.prev, sizeof(prev));
+                o.rec = nullptr;
+            }
+            return *this;
+        }
+        ~Trace() { finish(); }
+
+        void add(const glm::dvec3& p) {
+            if (!rec) return;
+            decimator.add(p, [this](const glm::dvec3& q) { keep(q); });
+            seen++;
+        }
+        void add(double x, double y) { add(glm::dvec3(x, y, 0.0)); }
+
+        // Flushes the last point and segment; further adds are ignored.
+        void finish() {
+            if (!rec) return;
+            decimator.finish([this](const glm::dvec3& q) { keep(q); });
+            flush();
+            rec = nullptr;
+        }
+
+    private:
+        friend class TrajectoryRecorder;
+        Trace(TrajectoryRecorder* r, uint64_t id)
+            : rec(r), id(id), decimator(r->tolerance, r->quantum) {}
+
+        void keep(const glm::dvec3& q) {
+            using namespace trajectory_detail;
+            for (int k = 0; k < rec->dims; ++k) {
+                int64_t v = std::llround(q[k] / rec->quantum);
+                putVarint(data, zigzag(count == 0 ? v : v - prev[k]));
+                prev[k] = v;
+            }
+            if (++count == SEGMENT_POINTS) flush();
+        }
+        void flush() {
+            rec->pointsSeen.fetch_add(seen, std::memory_order_relaxed);
+            seen = 0;
+            if (count == 0) return;
+            rec->submit(id, seq++, count, data);
+            data.clear();
+            count = 0;
+        }
+
+        TrajectoryRecorder* rec = nullptr;
+        uint64_t id = 0;
+        uint32_t seq = 0, count = 0;
+        uint64_t seen = 0;
+        TrajectoryDecimator decimator{0.0, 0.0};
+        std::vector<uint8_t> data;
+        int64_t prev[3] = {0, 0, 0};
+    };
+
+    // dims is 2 (x, y) or 3; quantum in meters; tolerance relative to r.
+    TrajectoryRecorder(const std::string& path, int dims, double quantum, double tolerance,
+                       size_t chunkBytes = size_t(1) << 20)
+        : dims(std::clamp(dims, 2, 3)), quantum(quantum), tolerance(tolerance), chunkBytes(chunkBytes) {
+        file = std::fopen(path.c_str(), "wb");
+        if (!file) return;
+        const uint32_t head[2] = { uint32_t(this->dims), 0 };
+        if (std::fwrite("BHTRJ001", 1, 8, file) != 8 || std::fwrite(head, 4, 2, file) != 2
+            || std::fwrite(&this->quantum, 8, 1, file) != 1) {
+            std::fclose(file);
+            file = nullptr;   // ok() is false and begin() records nothing
+            return;
+        }
+        fileSize = 24;
+        writer = std::thread([this] { writerLoop(); });
+    }
+    ~TrajectoryRecorder() { close(); }
+    TrajectoryRecorder(const TrajectoryRecorder&) = delete;
+    TrajectoryRecorder& operator=(const TrajectoryRecorder&) = delete;
+
+    bool ok() const { return file != nullptr && !failed; }
+    Trace begin(uint64_t trajectoryId) { return file ? Trace(this, trajectoryId) : Trace(); }
+
+    // Writes pending chunks and the index; traces still open are not flushed.
+    bool close() {
+        if (!file) return false;
+        {
+            std::unique_lock<std::mutex> lock(mtx);
+            if (!current.payload.empty()) queue.push_back(std::move(current));
+            current = Chunk();
+            stopping = true;
+        }
+        cv.notify_all();
+        writer.join();
+        std::sort(index.begin(), index.end(), [](const TrajectoryIndexEntry& a, const TrajectoryIndexEntry& b) {
+            return a.id != b.id ? a.id < b.id : a.seq < b.seq;
+        });
+        uint64_t trailer[2] = { fileSize, index.size() };
+        bool good = std::fwrite(index.data(), sizeof(TrajectoryIndexEntry), index.size(), file) == index.size()
+                 && std::fwrite(trailer, 8, 2, file) == 2 && std::fwrite("BHTRJIDX", 1, 8, file) == 8;
+        good = std::fclose(file) == 0 && good && !failed;
+        file = nullptr;
+        return good;
+    }
+
+    std::atomic<uint64_t> pointsSeen{0}, pointsKept{0}, bytesWritten{0};
+
+private:
+    struct Chunk {
+        std::vector<uint8_t> payload;
+        std::vector<TrajectoryIndexEntry> entries;   // offsets relative to the payload
+    };
+
+    void submit(uint64_t id, uint32_t seq, uint32_t points, const std::vector<uint8_t>& data) {
+        using namespace trajectory_detail;
+        pointsKept.fetch_add(points, std::memory_order_relaxed);
+        std::unique_lock<std::mutex> lock(mtx);
+        // bounded backlog: producers wait rather than grow memory without limit
+        spaceCv.wait(lock, [&] { return queue.size() < MAX_QUEUED || stopping; });
+        putVarint(current.payload, id);
+        putVarint(current.payload, seq);
+        putVarint(current.payload, points);
+        putVarint(current.payload, data.size());
+        current.entries.push_back({ id, current.payload.size(), uint32_t(data.size()), points, seq, 0 });
+        current.payload.insert(current.payload.end(), data.begin(), data.end());
+        if (current.payload.size() >= chunkBytes) {
+            queue.push_back(std::move(current));
+            current = Chunk();
+            cv.notify_one();
+        }
+    }
+
+    void writerLoop() {
+        using namespace trajectory_detail;
+        for (;;) {
+            Chunk chunk;
+            {
+                std::unique_lock<std::mutex> lock(mtx);
+                cv.wait(lock, [&] { return stopping || !queue.empty(); });
+                if (queue.empty()) return;
+                chunk = std::move(queue.front());
+                queue.pop_front();
+            }
+            spaceCv.notify_all();
+            const uint32_t head[2] = { CHUNK_MAGIC, uint32_t(chunk.payload.size()) };
+            bool good = std::fwrite(head, 4, 2, file) == 2
+                     && std::fwrite(chunk.payload.data(), 1, chunk.payload.size(), file) == chunk.payload.size();
+            if (!good) failed = true;
+            uint64_t base = fileSize + sizeof(head);
+            for (TrajectoryIndexEntry e : chunk.entries) {
+                e.offset += base;
+                index.push_back(e);
+            }
+            fileSize = base + chunk.payload.size();
+            bytesWritten = fileSize;
+        }
+    }
+
+    static constexpr size_t MAX_QUEUED = 16;
+
+    int dims;
+    double quantum, tolerance;
+    size_t chunkBytes;
+    FILE* file = nullptr;
+    uint64_t fileSize = 0;
+    std::atomic<bool> failed{false};
+    std::vector<TrajectoryIndexEntry> index;   // writer thread only until close()
+
+    std::mutex mtx;
+    std::condition_variable cv, spaceCv;
+    bool stopping = false;
+    Chunk current;
+    std::deque<Chunk> queue;
+    std::thread writer;
+};
+
+// traceGeodesic visitor that records the position after every step.
+inline auto recordTrajectory(TrajectoryRecorder::Trace& trace) {
+    return [&trace](const GeodesicRay& ray) {
+        trace.add(geodesicPosition(ray));
+        return true;
+    };
+}
+
+// Random access to a recorded file.
+class TrajectoryReader {
+public:
+    int dims = 0;
+    double quantum = 0.0;
+    std::vector<TrajectoryIndexEntry> index;   // sorted by (id, seq)
+    bool recoveredIndex = false;               // footer missing or damaged, rebuilt by scanning
+
+    bool open(const std::string& path) {
+        close();
+        file = std::fopen(path.c_str(), "rb");
+        if (!file) return false;
+        char magic[8];
+        uint32_t head[2];
+        long size;
+        if (std::fseek(file, 0, SEEK_END) != 0 || (size = std::ftell(file)) < 0 || std::fseek(file, 0, SEEK_SET) != 0)
+            return false;
+        fileBytes = uint64_t(size);
+        if (std::fread(magic, 1, 8, file) != 8 || std::memcmp(magic, "BHTRJ001", 8) != 0
+            || std::fread(head, 4, 2, file) != 2 || std::fread(&quantum, 8, 1, file) != 1)
+            return false;
+        dims = int(head[0]);
+        if (!readFooter()) {
+            recoveredIndex = true;
+            scanChunks();
+        }
+        return true;
+    }
+    ~TrajectoryReader() { close(); }
+    void close() {
+        if (file) std::fclose(file);
+        file = nullptr;
+        index.clear();
+    }
+
+    std::vector<uint64_t> ids() const {
+        std::vector<uint64_t> out;
+        for (const TrajectoryIndexEntry& e : index)
+            if (out.empty() || out.back() != e.id) out.push_back(e.id);
+        return out;
+    }
+
+    // Appends the points of trajectory id; false if it is unknown or damaged.
+    bool read(uint64_t id, std::vector<glm::dvec3>& out) {
+        using namespace trajectory_detail;
+        auto it = std::lower_bound(index.begin(), index.end(), id,
+                                   [](const TrajectoryIndexEntry& e, uint64_t v) { return e.id < v; });
+        if (it == index.end() || it->id != id) return false;
+        std::vector<uint8_t> buf;
+        for (; it != index.end() && it->id == id; ++it) {
+            buf.resize(it->bytes);
+            if (std::fseek(file, long(it->offset), SEEK_SET) != 0
+                || std::fread(buf.data(), 1, buf.size(), file) != buf.size())
+                return false;
+            const uint8_t* p = buf.data();
+            const uint8_t* end = p + buf.size();
+            int64_t q[3] = {0, 0, 0};
+            for (uint32_t i = 0; i < it->points; ++i) {
+                glm::dvec3 v(0.0);
+                for (int k = 0; k < dims; ++k) {
+                    uint64_t z;
+                    if (!getVarint(p, end, z)) return false;
+                    q[k] = i == 0 ? unzigzag(z) : q[k] + unzigzag(z);
+                    v[k] = double(q[k]) * quantum;
+                }
+                out.push_back(v);
+            }
+        }
+        return true;
+    }
+
+private:
+    // The footer's counts and offsets are checked against the file size
+    // before anything is allocated from them; a bad footer means a rescan.
+    bool readFooter() {
+        uint64_t trailer[2];
+        char magic[8];
+        if (fileBytes < 48 || std::fseek(file, -24, SEEK_END) != 0 || std::fread(trailer, 8, 2, file) != 2
+            || std::fread(magic, 1, 8, file) != 8 || std::memcmp(magic, "BHTRJIDX", 8) != 0)
+            return false;
+        const uint64_t indexEnd = fileBytes - 24;
+        if (trailer[0] < 24 || trailer[0] > indexEnd || trailer[1] > (indexEnd - trailer[0]) / sizeof(TrajectoryIndexEntry))
+            return false;
+        index.resize(trailer[1]);
+        bool ok = std::fseek(file, long(trailer[0]), SEEK_SET) == 0
+               && std::fread(index.data(), sizeof(TrajectoryIndexEntry), index.size(), file) == index.size();
+        for (const TrajectoryIndexEntry& e : index)
+            ok = ok && e.offset <= trailer[0] && e.bytes <= trailer[0] - e.offset;
+        if (!ok) index.clear();
+        return ok;
+    }
+
+    void scanChunks() {
+        using namespace trajectory_detail;
+        index.clear();
+        std::fseek(file, 24, SEEK_SET);
+        uint64_t pos = 24;
+        uint32_t head[2];
+        std::vector<uint8_t> payload;
+        while (std::fread(head, 4, 2, file) == 2 && head[0] == CHUNK_MAGIC && head[1] <= fileBytes - pos - 8) {
+            payload.resize(head[1]);
+            if (std::fread(payload.data(), 1, payload.size(), file) != payload.size()) break;
+            const uint8_t* p = payload.data();
+            const uint8_t* end = p + payload.size();
+            uint64_t id, seq, points, bytes;
+            while (p < end && getVarint(p, end, id) && getVarint(p, end, seq)
+                   && getVarint(p, end, points) && getVarint(p, end, bytes) && bytes <= uint64_t(end - p)) {
+                index.push_back({ id, pos + 8 + uint64_t(p - payload.data()), uint32_t(bytes),
+                                  uint32_t(points), uint32_t(seq), 0 });
+                p += bytes;
+            }
+            pos += 8 + payload.size();
+        }
+        std::sort(index.begin(), index.end(), [](const TrajectoryIndexEntry& a, const TrajectoryIndexEntry& b) {
+            return a.id != b.id ? a.id < b.id : a.seq < b.seq;
+        });
+    }
+
+    FILE* file = nullptr;
+    uint64_t fileBytes = 0;
+};